@@ -0,0 +1,262 @@
+/**
+ * Simulated annealing
+ * Random 2-opt, Or-opt and swap moves are priced in O(1) from the few edges they remove and
+ * add, and a move that makes the tour longer is still taken with a probability that falls as
+ * the temperature cools, so the walk can leave local optima. Half of the moves join a city to
+ * one of its candidates and the rest to any city, so it still works on weights where the
+ * nearest neighbors say little about good tours. The temperature follows a schedule over the
+ * budget, and when the best tour hasn't improved for a while it is reheated and the walk goes
+ * back to the best tour
+ */
+
+#ifndef TSP_ANNEAL_H
+#define TSP_ANNEAL_H
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include "LocalSearch.h"
+
+using namespace std;
+
+template <typename T>
+class Annealer : public LocalSearch<T>{
+public:
+    explicit Annealer(Graph<T>& gr) : LocalSearch<T>(gr) {}
+    vector<T> optimize(const vector<T>& path);
+    void setBudget(uint64_t moves, double seconds) {maxMoves = moves; maxSeconds = seconds;}
+    void setSchedule(cool_Type tp) {schedule = tp;}
+    void setTemperature(double start, double end) {startTemp = start; endTemp = end;}
+    void setReheat(double stall, double scale) {reheatStall = stall; reheatScale = scale;}
+    void setMoves(bool twoOpt, bool orOpt, bool swap) {useTwoOpt = twoOpt; useOrOpt = orOpt; useSwap = swap;}
+    void setSeed(uint32_t value) {seed = value;}
+    uint64_t getMoves() const {return moves;}
+    uint32_t getReheats() const {return reheats;}
+protected:
+    uint64_t maxMoves = 0;      // 0 with no time limit tries 1000 moves per city
+    double maxSeconds = 0;      // 0 has no time limit
+    cool_Type schedule = c_geometric;
+    double startTemp = 0;       // 0 is the mean edge weight of the starting tour
+    double endTemp = 0;         // 0 is a hundredth of the starting temperature
+    double reheatStall = 0.1;   // part of the budget without a new best that triggers a reheat
+    double reheatScale = 0.5;   // each reheat starts this much cooler than the last
+    bool useTwoOpt = true;
+    bool useOrOpt = true;
+    bool useSwap = true;
+    uint32_t seed = 1;
+    uint64_t moves = 0;
+    uint32_t reheats = 0;
+    long long twoOptDelta(ArrayTour& tour, mt19937& rng, uint32_t& a, uint32_t& c);
+    long long orOptDelta(ArrayTour& tour, mt19937& rng, uint32_t& s1, uint32_t& s2, uint32_t& u, bool& forward);
+    long long swapDelta(ArrayTour& tour, mt19937& rng, uint32_t& a, uint32_t& b);
+    uint32_t partner(uint32_t city, mt19937& rng) const;
+    double temperature(double progress, double top) const;
+};
+
+/**
+ * Anneals a tour until the move or time budget runs out
+ * @tparam T is the type of the graph
+ * @param path is a closed tour to start from, like the one returned by getPath
+ * @return the best tour found, or the same one if it doesn't visit every node exactly once
+ */
+template <typename T>
+vector<T> Annealer<T>::optimize(const vector<T>& path) {
+    static const uint32_t CHECK = 1024;     // moves between looks at the clock
+    vector<uint32_t> order;
+    moves = 0;
+    reheats = 0;
+    if(!this->toIds(path, order) || order.size() < 8 || !(useTwoOpt || useOrOpt || useSwap))
+        return path;
+    auto start = chrono::steady_clock::now();
+    uint32_t n = static_cast<uint32_t>(order.size());
+    uint64_t budget = maxMoves;
+    if(budget == 0 && maxSeconds <= 0)
+        budget = 1000 * static_cast<uint64_t>(n);
+    mt19937 rng(seed);
+    ArrayTour tour(order);
+    long long cost = 0;     // priced like the moves, so a missing edge counts
+    for(uint32_t i = 0; i < n; i++)
+        cost += this->dist(order[i], order[(i + 1) % n]);
+    long long bestCost = cost;
+    // hot enough to take a move that adds about one edge, which keeps the walk close to the
+    // starting tour instead of throwing it away
+    double top = startTemp > 0 ? startTemp : max(1.0, static_cast<double>(cost) / n);
+    vector<uint32_t> best = order;
+    bool atBest = true;     // the best tour is only copied when the walk leaves it
+    double progress = 0, phase = 0, lastBest = 0, temp = top;
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    int kinds[3], count = 0;
+    if(useTwoOpt)
+        kinds[count++] = 0;
+    if(useOrOpt)
+        kinds[count++] = 1;
+    if(useSwap)
+        kinds[count++] = 2;
+    while(budget == 0 || moves < budget){
+        if(moves % CHECK == 0) {
+            double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+            progress = 0;
+            if(budget > 0)
+                progress = static_cast<double>(moves) / budget;
+            if(maxSeconds > 0)
+                progress = max(progress, seconds / maxSeconds);
+            if(progress >= 1)
+                break;
+            if(reheatStall > 0 && progress - lastBest > reheatStall && progress < 1 - reheatStall) {
+                // starts the schedule over from a cooler top, walking from the best tour
+                reheats++;
+                top *= reheatScale;
+                phase = progress;
+                lastBest = progress;
+                if(!atBest) {
+                    tour.load(best);
+                    cost = bestCost;
+                    atBest = true;
+                }
+            }
+            temp = temperature((progress - phase) / (1 - phase), top);
+        }
+        moves++;
+        uint32_t a = 0, b = 0, c = 0;
+        bool forward = false;
+        int kind = kinds[rng() % count];
+        long long delta;
+        if(kind == 0)
+            delta = twoOptDelta(tour, rng, a, c);
+        else if(kind == 1)
+            delta = orOptDelta(tour, rng, a, b, c, forward);
+        else
+            delta = swapDelta(tour, rng, a, b);
+        if(delta == LLONG_MAX || (delta > 0 && unit(rng) >= exp(-delta / temp)))
+            continue;
+        if(delta > 0 && atBest) {
+            best = tour.getOrder();
+            atBest = false;
+        }
+        if(kind == 0)
+            tour.flip(tour.next(a), c);
+        else if(kind == 1)
+            this->moveSegment(tour, a, b, c, forward);
+        else
+            tour.swapCities(a, b);
+        cost += delta;
+        if(cost <= bestCost) {  // a tour as short as the best one is as good to keep
+            if(cost < bestCost)
+                lastBest = progress;
+            bestCost = cost;
+            atBest = true;
+        }
+    }
+    return this->toPath(atBest ? tour.getOrder() : best);
+}
+
+/**
+ * Picks a random 2-opt move, removing (a, next(a)) and (c, next(c)) and adding (a, c) and
+ * (next(a), next(c))
+ * @tparam T is the type of the graph
+ * @param tour is the current tour
+ * @param rng picks the move
+ * @param a is set to the first city
+ * @param c is set to the second city
+ * @return how much longer the move makes the tour, or LLONG_MAX if it changes nothing
+ */
+template <typename T>
+long long Annealer<T>::twoOptDelta(ArrayTour& tour, mt19937& rng, uint32_t& a, uint32_t& c) {
+    uint32_t n = tour.size();
+    a = rng() % n;
+    c = partner(a, rng);
+    uint32_t b = tour.next(a), d = tour.next(c);
+    if(a == c || b == c || d == a)
+        return LLONG_MAX;
+    return this->dist(a, c) + this->dist(b, d) - this->dist(a, b) - this->dist(c, d);
+}
+
+/**
+ * Picks a random Or-opt move, taking a segment of 1 to 3 cities out and putting it between a
+ * random city and the one after it, either way around
+ * @tparam T is the type of the graph
+ * @param tour is the current tour
+ * @param rng picks the move
+ * @param s1 is set to the first city of the segment
+ * @param s2 is set to the last city of the segment
+ * @param u is set to the city the segment goes after
+ * @param forward is set to true if s1 ends up next to u
+ * @return how much longer the move makes the tour, or LLONG_MAX if it changes nothing
+ */
+template <typename T>
+long long Annealer<T>::orOptDelta(ArrayTour& tour, mt19937& rng, uint32_t& s1, uint32_t& s2, uint32_t& u, bool& forward) {
+    uint32_t n = tour.size();
+    s1 = rng() % n;
+    s2 = s1;
+    for(uint32_t len = rng() % 3; len > 0; len--)
+        s2 = tour.next(s2);
+    forward = rng() % 2 == 0;
+    u = partner(forward ? s1 : s2, rng);
+    uint32_t p = tour.prev(s1), nx = tour.next(s2), v = tour.next(u);
+    if(u == p || tour.between(s1, u, s2))
+        return LLONG_MAX;
+    uint32_t nearU = forward ? s1 : s2, nearV = forward ? s2 : s1;
+    return this->dist(p, nx) + this->dist(u, nearU) + this->dist(nearV, v)
+           - this->dist(p, s1) - this->dist(s2, nx) - this->dist(u, v);
+}
+
+/**
+ * Picks two random cities to exchange
+ * @tparam T is the type of the graph
+ * @param tour is the current tour
+ * @param rng picks the move
+ * @param a is set to one of the cities
+ * @param b is set to the other city
+ * @return how much longer the move makes the tour, or LLONG_MAX if it changes nothing
+ */
+template <typename T>
+long long Annealer<T>::swapDelta(ArrayTour& tour, mt19937& rng, uint32_t& a, uint32_t& b) {
+    uint32_t n = tour.size();
+    a = rng() % n;
+    b = partner(a, rng);
+    if(a == b)
+        return LLONG_MAX;
+    if(tour.next(b) == a)
+        swap(a, b);
+    uint32_t pa = tour.prev(a), na = tour.next(a), pb = tour.prev(b), nb = tour.next(b);
+    if(na == b)     // neighbors, only the edges on the outside change
+        return this->dist(pa, b) + this->dist(a, nb) - this->dist(pa, a) - this->dist(b, nb);
+    return this->dist(pa, b) + this->dist(b, na) + this->dist(pb, a) + this->dist(a, nb)
+           - this->dist(pa, a) - this->dist(a, na) - this->dist(pb, b) - this->dist(b, nb);
+}
+
+/**
+ * Picks the city a move joins another one to. Half of the picks come from the candidate list
+ * so short edges are tried often, the rest are uniform so weights without any neighborhood
+ * structure still get explored
+ * @tparam T is the type of the graph
+ * @param city is the city the move starts from
+ * @param rng picks the city
+ * @return the picked city
+ */
+template <typename T>
+uint32_t Annealer<T>::partner(uint32_t city, mt19937& rng) const {
+    uint32_t count = this->cand.count(city);
+    if(count > 0 && rng() % 2 == 0)
+        return this->cand.get(city)[rng() % count];
+    return rng() % this->cand.getNumNodes();
+}
+
+/**
+ * Temperature along the schedule
+ * @tparam T is the type of the graph
+ * @param progress is how far through the schedule the search is, from 0 to 1
+ * @param top is the temperature the schedule starts from
+ * @return the temperature
+ */
+template <typename T>
+double Annealer<T>::temperature(double progress, double top) const {
+    double bottom = endTemp > 0 ? min(endTemp, top) : top / 100;
+    if(schedule == c_linear)
+        return max(top + (bottom - top) * progress, 1e-9);
+    return top * pow(bottom / top, progress);
+}
+
+#endif //TSP_ANNEAL_H
@@ -0,0 +1,273 @@
+/**
+ * Candidate neighbor lists for local search
+ * Every node keeps k neighbors sorted by weight, so improvement moves only look at edges that
+ * are likely to be in a good tour. The neighbors are either the nearest ones or the ones with
+ * the lowest alpha values from a minimum 1-tree, and either way the lists are built across a
+ * thread pool and can be saved to a file and loaded back on a later run
+ */
+
+#ifndef TSP_CANDIDATES_H
+#define TSP_CANDIDATES_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <tuple>
+#include <fstream>
+#include "Graph.h"
+#include "OneTree.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+class CandidateSet{
+public:
+    template <typename T>
+    void build(Graph<T>& graph, uint32_t size, unsigned threads = 0);
+    template <typename T>
+    void buildAlpha(Graph<T>& graph, uint32_t size, unsigned threads = 0, const vector<double>& pi = vector<double>());
+    template <typename T>
+    static uint64_t fingerprint(const Graph<T>& graph);
+    bool save(const string& fileName, uint64_t key) const;
+    bool load(const string& fileName, uint64_t key);
+    void clear();
+    bool isEmpty() const {return n == 0;}
+    uint32_t getK() const {return k;}
+    uint32_t getNumNodes() const {return n;}
+    uint32_t count(uint32_t node) const {return counts[node];}
+    const uint32_t* get(uint32_t node) const {return lists.data() + static_cast<size_t>(node) * k;}
+private:
+    uint32_t n = 0;
+    uint32_t k = 0;
+    vector<uint32_t> lists;     // k slots per node, nearest first
+    vector<uint32_t> counts;    // how many slots of each node are used
+    template <typename T>
+    static void neighborsOf(Graph<T>& graph, uint32_t from, vector<pair<int, uint32_t>>& near);
+};
+
+/**
+ * Finds the nearest neighbors of every node. Ties are broken by id so the lists don't
+ * depend on the thread count
+ * @tparam T is the type of the graph
+ * @param graph is the graph to take the weights from
+ * @param size is the number of neighbors to keep for each node
+ * @param threads is the number of threads to use, 0 uses every hardware thread
+ */
+template <typename T>
+void CandidateSet::build(Graph<T>& graph, uint32_t size, unsigned threads) {
+    graph.buildIndex();
+    if(!graph.isDense())    // dense graphs are scanned straight from the matrix
+        graph.buildAdjacency();
+    n = graph.getNumNodes();
+    k = n == 0 ? 0 : min(size, n - 1);
+    lists.assign(static_cast<size_t>(n) * k, NO_ID);
+    counts.assign(n, 0);
+    if(k == 0)
+        return;
+    ThreadPool pool(threads);
+    pool.parallelFor(0, n, [&](size_t lo, size_t hi, unsigned) {
+        vector<pair<int, uint32_t>> near;
+        for(size_t i = lo; i < hi; i++){
+            neighborsOf(graph, static_cast<uint32_t>(i), near);
+            size_t keep = min<size_t>(k, near.size());
+            partial_sort(near.begin(), near.begin() + keep, near.end());
+            uint32_t* list = lists.data() + i * k;
+            for(size_t j = 0; j < keep; j++)
+                list[j] = near[j].second;
+            counts[i] = static_cast<uint32_t>(keep);
+        }
+    });
+}
+
+/**
+ * Ranks the neighbors of every node by alpha-nearness from a minimum 1-tree built on
+ * getMinSpanIds. Ties are broken by weight and then id, and the kept neighbors are sorted by
+ * weight like the nearest neighbor lists so the searches can still stop at the first one
+ * that's too far away. Alpha values for every pair take one pass over the tree per node, so
+ * on dense graphs this is O(n^2), and sparse graphs climb the tree for each of their edges
+ * @tparam T is the type of the graph
+ * @param graph is the graph to take the weights from
+ * @param size is the number of neighbors to keep for each node
+ * @param threads is the number of threads to use, 0 uses every hardware thread
+ * @param pi is a penalty on every node the 1-tree is built with, empty for none, in which
+ * case the graph's own spanning tree is used
+ */
+template <typename T>
+void CandidateSet::buildAlpha(Graph<T>& graph, uint32_t size, unsigned threads, const vector<double>& pi) {
+    graph.buildIndex();
+    if(!graph.isDense())
+        graph.buildAdjacency();
+    n = graph.getNumNodes();
+    k = n == 0 ? 0 : min(size, n - 1);
+    lists.assign(static_cast<size_t>(n) * k, NO_ID);
+    counts.assign(n, 0);
+    if(k == 0)
+        return;
+    bool penalized = false;
+    for(double p : pi)
+        penalized = penalized || p != 0;
+    // the graph's cached tree is only the lightest one without penalties
+    vector<idEdge> span = penalized ? OneTree::span(graph, pi) : graph.getMinSpanIds();
+    OneTree tree;
+    tree.build(graph, span, pi);
+    bool dense = graph.isDense();
+    ThreadPool pool(threads);
+    pool.parallelFor(0, n, [&](size_t lo, size_t hi, unsigned) {
+        vector<pair<int, uint32_t>> near;
+        vector<tuple<double, int, uint32_t>> ranked;
+        vector<double> longest(dense ? n : 0);
+        vector<uint32_t> mark(dense ? n : 0, NO_ID);
+        for(size_t i = lo; i < hi; i++){
+            uint32_t from = static_cast<uint32_t>(i);
+            neighborsOf(graph, from, near);
+            if(dense && from != tree.getSpecial())
+                tree.beta(from, longest, mark);
+            ranked.clear();
+            for(const pair<int, uint32_t>& p : near){
+                uint32_t to = p.second;
+                double path = 0;
+                if(from != tree.getSpecial() && to != tree.getSpecial())
+                    path = dense ? longest[to] : tree.pathMax(from, to);
+                ranked.push_back(make_tuple(tree.alpha(from, to, tree.cost(graph, from, to), path), p.first, to));
+            }
+            size_t keep = min<size_t>(k, ranked.size());
+            partial_sort(ranked.begin(), ranked.begin() + keep, ranked.end());
+            sort(ranked.begin(), ranked.begin() + keep, [](const tuple<double, int, uint32_t>& one, const tuple<double, int, uint32_t>& two) {
+                return std::get<1>(one) != std::get<1>(two) ? std::get<1>(one) < std::get<1>(two) : std::get<2>(one) < std::get<2>(two);
+            });
+            uint32_t* list = lists.data() + i * k;
+            for(size_t j = 0; j < keep; j++)
+                list[j] = std::get<2>(ranked[j]);
+            counts[i] = static_cast<uint32_t>(keep);
+        }
+    });
+}
+
+/**
+ * Gathers every neighbor of a node with the weight of the edge, keeping only the lightest of
+ * parallel edges
+ * @tparam T is the type of the graph
+ * @param graph is the graph to take the weights from
+ * @param from is the node
+ * @param near is set to pairs of weight and neighbor
+ */
+template <typename T>
+void CandidateSet::neighborsOf(Graph<T>& graph, uint32_t from, vector<pair<int, uint32_t>>& near) {
+    near.clear();
+    uint32_t n = graph.getNumNodes();
+    if(graph.isDense()) {   // every other node is a neighbor
+        for(uint32_t to = 0; to < n; to++){
+            int weight = graph.getWeight(from, to);
+            if(to != from && weight != -1)
+                near.push_back(pair<int, uint32_t>(weight, to));
+        }
+        return;
+    }
+    const uint32_t* edges = graph.getNeighbors(from);
+    const int* wgts = graph.getNeighborWeights(from);
+    for(uint32_t j = 0; j < graph.getDegree(from); j++)
+        if(edges[j] != from)
+            near.push_back(pair<int, uint32_t>(wgts[j], edges[j]));
+    // parallel edges show up more than once, only the lightest one is kept
+    sort(near.begin(), near.end(), [](const pair<int, uint32_t>& one, const pair<int, uint32_t>& two) {
+        return one.second != two.second ? one.second < two.second : one.first < two.first;
+    });
+    near.erase(unique(near.begin(), near.end(), [](const pair<int, uint32_t>& one, const pair<int, uint32_t>& two) {
+        return one.second == two.second;
+    }), near.end());
+}
+
+/**
+ * Hashes the edges of a graph, so lists saved for one graph aren't loaded for another
+ * @tparam T is the type of the graph
+ * @param graph is the graph to hash
+ * @return a 64 bit FNV-1a hash of the node count and every edge
+ */
+template <typename T>
+uint64_t CandidateSet::fingerprint(const Graph<T>& graph) {
+    uint64_t hash = 14695981039346656037ULL;
+    auto mix = [&](uint32_t value) {
+        for(int b = 0; b < 4; b++){
+            hash ^= (value >> (8 * b)) & 0xFF;
+            hash *= 1099511628211ULL;
+        }
+    };
+    mix(graph.getNumNodes());
+    graph.forEachEdge([&](const idEdge& e) {
+        mix(e.from);
+        mix(e.to);
+        mix(static_cast<uint32_t>(e.weight));
+    });
+    return hash;
+}
+
+/**
+ * Writes the lists to a binary file: a tag, the node count, k, the key, then the counts and
+ * the lists
+ * @param fileName is the file to write
+ * @param key is stored with the lists, like the fingerprint of the graph they were built on
+ * @return true if the file was written
+ */
+inline bool CandidateSet::save(const string& fileName, uint64_t key) const {
+    ofstream file(fileName, ios::binary);
+    if(!file.is_open())
+        return false;
+    const uint32_t tag = 0x43505354;    // "TSPC"
+    file.write(reinterpret_cast<const char*>(&tag), sizeof(tag));
+    file.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    file.write(reinterpret_cast<const char*>(&k), sizeof(k));
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(uint32_t));
+    file.write(reinterpret_cast<const char*>(lists.data()), lists.size() * sizeof(uint32_t));
+    return file.good();
+}
+
+/**
+ * Reads lists written by save. Nothing changes unless the whole file reads back with the same
+ * key and every entry is in range
+ * @param fileName is the file to read
+ * @param key has to match the key the lists were saved with
+ * @return true if the lists were loaded
+ */
+inline bool CandidateSet::load(const string& fileName, uint64_t key) {
+    ifstream file(fileName, ios::binary);
+    if(!file.is_open())
+        return false;
+    uint32_t tag = 0, size = 0, width = 0;
+    uint64_t stored = 0;
+    file.read(reinterpret_cast<char*>(&tag), sizeof(tag));
+    file.read(reinterpret_cast<char*>(&size), sizeof(size));
+    file.read(reinterpret_cast<char*>(&width), sizeof(width));
+    file.read(reinterpret_cast<char*>(&stored), sizeof(stored));
+    if(!file || tag != 0x43505354 || stored != key || (size > 0 && width >= size))
+        return false;
+    vector<uint32_t> inCounts(size), inLists(static_cast<size_t>(size) * width);
+    file.read(reinterpret_cast<char*>(inCounts.data()), inCounts.size() * sizeof(uint32_t));
+    file.read(reinterpret_cast<char*>(inLists.data()), inLists.size() * sizeof(uint32_t));
+    if(!file)
+        return false;
+    for(uint32_t i = 0; i < size; i++){
+        if(inCounts[i] > width)
+            return false;
+        for(uint32_t j = 0; j < inCounts[i]; j++)
+            if(inLists[static_cast<size_t>(i) * width + j] >= size)
+                return false;
+    }
+    n = size;
+    k = width;
+    counts.swap(inCounts);
+    lists.swap(inLists);
+    return true;
+}
+
+/**
+ * Frees the lists
+ */
+inline void CandidateSet::clear() {
+    n = 0;
+    k = 0;
+    vector<uint32_t>().swap(lists);
+    vector<uint32_t>().swap(counts);
+}
+
+#endif //TSP_CANDIDATES_H
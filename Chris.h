@@ -8,12 +8,12 @@
 #define TSP_CHRIS_H
 
 #include "Graph.h"
-#include "Set.h"
 #include <vector>
 #include <cstdlib>
 #include <algorithm>
 #include <climits>
-#include <stack>
+#include "Matching.h"
+#include "Kernels.h"
 
 using namespace std;
 
@@ -22,12 +22,18 @@ class Chris : public Graph<T>{
 public:
     vector<T> getPath();
     vector<T> calcOddEdges();
-    vector<weightEdge<T>> perfectMatch(vector<T> odds, vector<weightEdge<T>> weights);
+    vector<weightEdge<T>> perfectMatch(vector<T> odds);
+    void setExactMatchLimit(uint32_t limit) {exactLimit = limit;}
     void merge(vector<weightEdge<T>> edges);
     vector<T> euler();
-    vector<T> hamilton(vector<T> ePath);
+    vector<T> hamilton(const vector<T>& ePath);
+    void setBestShortcut(bool best) {bestShortcut = best;}
 private:
-    weightEdge<T> findInWeights(T from, T to, vector<weightEdge<T>> weights);
+    uint32_t exactLimit = 1000;  // most odd vertices matched with the blossom algorithm
+    bool bestShortcut = true;   // keep the visit that is cheapest to keep instead of the first
+    vector<uint32_t> shortcutFirst(const vector<uint32_t>& walk);
+    vector<uint32_t> shortcutBest(const vector<uint32_t>& walk);
+    long long shortcutCost(uint32_t from, uint32_t to) const;
 };
 
 /**
@@ -37,25 +43,30 @@ private:
  */
 template <typename T>
 vector<T> Chris<T>::getPath() {
+    this->buildIndex();
     // find the minimum spanning tree
     vector<weightEdge<T>> vec = this->getMinSpan();
     auto* subGraph = new Chris<T>();
-    // create a new graph out of the spanning tree
+    // create a new graph out of the spanning tree, adding the nodes in the same order so both
+    // graphs share ids
+    for(uint32_t i = 0; i < this->getNumNodes(); i++)
+        subGraph->addNode(this->labels[i]);
     for(int i = 0; i < vec.size(); i++){
-        subGraph->addNode(vec[i].from);
-        subGraph->addNode(vec[i].to);
         subGraph->addEdge(vec[i].from, vec[i].to, vec[i].weight);
     }
     // find the vertices with odd degrees
     vector<T> odds = subGraph->calcOddEdges();
     // perform minimum-weight perfect matching on the odd vertices
-    vector<weightEdge<T>> perf = perfectMatch(odds, subGraph->weights);
+    vector<weightEdge<T>> perf = perfectMatch(odds);
     // merge the perfect matches into the minimum spanning tree
     subGraph->merge(perf);
     // find the eulerian path
     vector<T> ePath = subGraph->euler();
-    // from the eulerian path, find the hamiltonian path and return it
-    return subGraph->hamilton(ePath);
+    // from the eulerian path, find the hamiltonian path and return it, shortcuts are weighed
+    // with the full graph since they leave the spanning tree
+    vector<T> path = hamilton(ePath);
+    delete subGraph;
+    return path;
 }
 
 /**
@@ -66,87 +77,42 @@ vector<T> Chris<T>::getPath() {
 template <typename T>
 vector<T> Chris<T>::calcOddEdges() {
     vector<T> toReturn;
-    for(auto iter = this->nodes.begin(); iter != this->nodes.end(); iter++){
-        vector<T> edges = iter->second.edges;
-        if(edges.size() % 2  == 1){
-            toReturn.push_back(iter->first);
+    for(uint32_t i = 0; i < this->getNumNodes(); i++){
+        if(this->getDegree(i) % 2  == 1){
+            toReturn.push_back(this->labels[i]);
         }
     }
     return toReturn;
 }
 
 /**
- * matches each vertices with an odd degree to another that has the smallest weight possible
+ * Finds the minimum-weight perfect matching between the vertices with odd degrees over the
+ * whole graph, exactly with the blossom algorithm unless there are more odd vertices than
+ * the exact limit
  * @tparam T is the type of the graph
  * @param odds is the vector that contains all the odd edges to be matched
- * @param weights is the edges in the minimum spanning tree
  * @return a vector of the weighted edges that represent the matches
  */
 template <typename T>
-vector<weightEdge<T>> Chris<T>::perfectMatch(vector<T> odds, vector<weightEdge<T>> weights) {
+vector<weightEdge<T>> Chris<T>::perfectMatch(vector<T> odds) {
     vector<weightEdge<T>> toReturn;
-    while(!odds.empty()){
-        T cur = *odds.begin();
-        //finds a vertex with an odd degree in the graph
-        auto mapFind = this->nodes.find(cur);
-        weightEdge<T> temp;
-        if(mapFind != this->nodes.end()){
-            vector<T> edges = mapFind->second.edges;
-            int curWeight = INT_MAX;
-            // searches through all the connections that the current vertex has
-            for(int i = 0; i < edges.size(); i++){
-                auto fnd = find(odds.begin(), odds.end(), edges[i]);
-                if(fnd != odds.end()){
-                    // finds the weighted edge representing the pair of nodes
-                    weightEdge<T> wE = findInWeights(cur, edges[i], this->weights);
-                    // attempts to find the edge in the minimum spanning tree
-                    weightEdge<T> test = findInWeights(cur, edges[i], weights);
-                    // if the edge is in the minimum spanning tree, don't add it
-                    if(test.weight == -1) {
-                        if (wE.weight < curWeight) {
-                            curWeight = wE.weight;
-                            temp = wE;
-                        }
-                    }
-                }
-            }
-            if(curWeight < INT_MAX){ // adds the best match to the vector
-                toReturn.push_back(temp);
-                // erases both nodes in the odds vector so they aren't used again
-                auto loc = find(odds.begin(), odds.end(), temp.to);
-                odds.erase(loc);
-                loc = find(odds.begin(), odds.end(), temp.from);
-                odds.erase(loc);
-            }
-        }
+    vector<uint32_t> ids;
+    for(unsigned int i = 0; i < odds.size(); i++)
+        ids.push_back(this->getId(odds[i]));
+    auto cost = [this](uint32_t a, uint32_t b) {return this->getWeight(a, b);};
+    vector<pair<uint32_t, uint32_t>> pairs = minPerfectMatching(ids, cost, exactLimit);
+    for(unsigned int i = 0; i < pairs.size(); i++){ // adds each match to the vector
+        weightEdge<T> wE;
+        wE.from = this->labels[pairs[i].first];
+        wE.to = this->labels[pairs[i].second];
+        wE.weight = this->getWeight(pairs[i].first, pairs[i].second);
+        toReturn.push_back(wE);
     }
+    if(toReturn.size() * 2 < odds.size()) // only possible if the graph isn't complete
+        cout << "Could not match " << odds.size() - toReturn.size() * 2 << " odd vertices" << endl;
     return toReturn;
 }
 
-/**
- * Finds the weighted edge representing a pair of nodes in the given vector of weighted edges
- * @tparam T is the type of the graph
- * @param from is the source city
- * @param to is the destination city
- * @param weights is the vector of weighted edges to find the pair of nodes in
- * @return the weighted edge between the two nodes
- */
-template <typename T>
-weightEdge<T> Chris<T>::findInWeights(T from, T to, vector<weightEdge<T>> weights) {
-    for(int i = 0; i < weights.size(); i++){
-        weightEdge<T> wE = weights[i];
-        if(wE.to == from || wE.to == to){ //undirected
-            if(wE.from == from || wE.from == to){
-                return wE;
-            }
-        }
-    }
-    weightEdge<T> def;
-    def.weight = -1;
-    return def;
-}
-
-
 /**
  * Takes in a vector of weighted edges and adds them into the graph
  * @tparam T is the type of the graph
@@ -160,83 +126,168 @@ void Chris<T>::merge(vector<weightEdge<T>> edges) {
 }
 
 /**
- * Finds the euler circuit in a graph
+ * Finds the euler circuit in a graph with Hierholzer's algorithm. Parallel edges, like a tree
+ * edge that was also matched, are separate entries in the adjacency so each one is walked.
+ * Every edge has a used flag and every vertex a cursor into its adjacency, so each edge is
+ * looked at a constant number of times
  * @tparam T is the type of the graph
  * @return a vector representing the path
  */
 template <typename T>
 vector<T> Chris<T>::euler() {
     vector<T> path;
-    vector<weightEdge<T>> toIgnore; // contains a list of edges that have already been visited
-    auto iter = this->nodes.begin();
-    stack<T> stk;
-    stk.push(iter->first);
-    T cur = stk.top();
+    uint32_t n = this->getNumNodes();
+    if(n == 0)
+        return path;
+    this->buildAdjacency();
+    uint32_t start = 0;
+    while(start < n && this->getDegree(start) == 0) // the first vertex with an edge
+        start++;
+    if(start == n)
+        start = 0;
+    vector<char> used(this->edgeList.size(), 0);
+    vector<uint32_t> cursor(this->offsets.begin(), this->offsets.end() - 1);
+    vector<uint32_t> stk;
+    stk.push_back(start);
     while(!stk.empty()){
-        iter = this->nodes.find(cur);
-        vector<T> edges = iter->second.edges;
-        bool hasConnect = false;
-        int index = -1;
-        // attempts to find a connection that has not been used yet
-        for(int i = 0; i < edges.size(); i++) {
-            T con = edges[i];
-            bool isValid = true;
-            for(int j = 0; j < toIgnore.size(); j++){
-                if(con == toIgnore[j].to || con == toIgnore[j].from) { //undirected
-                    if (cur == toIgnore[j].to || cur == toIgnore[j].from){
-                        isValid = false;
-                        break;
-                    }
-                }
-            }
-            hasConnect = hasConnect || isValid;
-            if(hasConnect) { // uses the first available connection
-                index = i;
-                break;
-            }
+        uint32_t cur = stk.back();
+        uint32_t& pos = cursor[cur];
+        while(pos < this->offsets[cur + 1] && used[this->adjEdges[pos]]) // skips edges walked from the other end
+            pos++;
+        if(pos == this->offsets[cur + 1]){ // if there are no more edges, it is part of the circuit
+            path.push_back(this->labels[cur]);
+            stk.pop_back();
         }
-        if(!hasConnect){ // if there are no more connections, pop it off the stack
-            path.push_back(cur);
-            cur = stk.top();
-            stk.pop();
-        }
-        else{ // visit the edge and push the destination node onto the stack
-            weightEdge<T> wE;
-            wE.from = cur;
-            wE.to = edges[index];
-            toIgnore.push_back(wE);
-            stk.push(cur);
-            cur = edges[index];
+        else{ // walk the edge and continue from the other end
+            used[this->adjEdges[pos]] = 1;
+            stk.push_back(this->adjacency[pos]);
+            pos++;
         }
     }
     return path;
 }
 
 /**
- * Takes in a eulerian path and ignores repeated vertices to create a hamiltonian path
+ * Takes in a eulerian path and skips repeated vertices to create a hamiltonian path. By default
+ * each repeated vertex keeps the visit that saves the least when skipped, so skipping the
+ * others saves the most, otherwise the first visit is kept
  * @tparam T is the type of the graph
  * @param ePath is a vector of T objects representing the eulerian path
  * @return a vector of T objects representing the hamiltonian path
  */
 template <typename T>
-vector<T> Chris<T>::hamilton(vector<T> ePath) {
-    vector<T> toIgnore;
+vector<T> Chris<T>::hamilton(const vector<T>& ePath) {
     vector<T> hamilton;
-    auto iter = ePath.begin();
-    T start = *iter;
-    while(iter != ePath.end()){
-        T cur = *iter;
-        auto fnd = find(toIgnore.begin(), toIgnore.end(), cur);
-        if(fnd == toIgnore.end()){ // only use vertices that haven't been visited
-            hamilton.push_back(cur);
-            toIgnore.push_back(cur);
-            iter++;
+    if(ePath.empty())
+        return hamilton;
+    vector<uint32_t> walk;
+    walk.reserve(ePath.size());
+    for(unsigned int i = 0; i < ePath.size(); i++)
+        walk.push_back(this->getId(ePath[i]));
+    vector<uint32_t> tour = bestShortcut ? shortcutBest(walk) : shortcutFirst(walk);
+    for(unsigned int i = 0; i < tour.size(); i++)
+        hamilton.push_back(this->labels[tour[i]]);
+    hamilton.push_back(hamilton[0]);
+    return hamilton;
+}
+
+/**
+ * Keeps the first visit to every vertex of a walk
+ * @tparam T is the type of the graph
+ * @param walk is the ids of the eulerian path
+ * @return the ids of the tour, without returning to the start
+ */
+template <typename T>
+vector<uint32_t> Chris<T>::shortcutFirst(const vector<uint32_t>& walk) {
+    vector<uint32_t> tour;
+    vector<uint64_t> visited((this->getNumNodes() + 63) / 64, 0);
+    for(unsigned int i = 0; i < walk.size(); i++){
+        if(!testBit(visited.data(), walk[i])){ // only use vertices that haven't been visited
+            visited[walk[i] >> 6] |= uint64_t(1) << (walk[i] & 63);
+            tour.push_back(walk[i]);
+        }
+    }
+    return tour;
+}
+
+/**
+ * Keeps one visit to every vertex of a closed walk, choosing the one that saves the least when
+ * it is skipped. The walk is a circular linked list, and the vertices are decided in the order
+ * they first appear, so each decision sees the skips that came before it
+ * @tparam T is the type of the graph
+ * @param walk is the ids of the eulerian circuit, starting and ending at the same vertex
+ * @return the ids of the tour starting at the first vertex of the walk, without returning to it
+ */
+template <typename T>
+vector<uint32_t> Chris<T>::shortcutBest(const vector<uint32_t>& walk) {
+    uint32_t n = this->getNumNodes();
+    uint32_t len = static_cast<uint32_t>(walk.size());
+    if(len > 1 && walk[0] == walk[len - 1])  // the closing visit is the first one again
+        len--;
+    // the positions of every vertex's visits, grouped by vertex
+    vector<uint32_t> first(n + 1, 0);
+    for(uint32_t i = 0; i < len; i++)
+        first[walk[i] + 1]++;
+    for(uint32_t i = 0; i < n; i++)
+        first[i + 1] += first[i];
+    vector<uint32_t> visits(len);
+    vector<uint32_t> fill(first.begin(), first.end() - 1);
+    for(uint32_t i = 0; i < len; i++)
+        visits[fill[walk[i]]++] = i;
+    vector<uint32_t> prev(len), next(len);
+    for(uint32_t i = 0; i < len; i++){
+        prev[i] = i == 0 ? len - 1 : i - 1;
+        next[i] = i + 1 == len ? 0 : i + 1;
+    }
+    vector<uint32_t> kept(n, NO_ID);
+    for(uint32_t i = 0; i < len; i++){
+        uint32_t v = walk[i];
+        if(kept[v] != NO_ID)
+            continue;
+        uint32_t best = NO_ID;
+        long long bestSaving = 0;
+        for(uint32_t j = first[v]; j < first[v + 1]; j++){ // the saving of skipping each visit
+            uint32_t at = visits[j];
+            uint32_t before = walk[prev[at]], after = walk[next[at]];
+            long long saving = shortcutCost(before, v) + shortcutCost(v, after) - shortcutCost(before, after);
+            if(best == NO_ID || saving < bestSaving){
+                best = at;
+                bestSaving = saving;
+            }
         }
-        else {
-            iter = ePath.erase(iter); // ignores repeated vertices
+        kept[v] = best;
+        for(uint32_t j = first[v]; j < first[v + 1]; j++){ // skips every other visit
+            uint32_t at = visits[j];
+            if(at == best)
+                continue;
+            next[prev[at]] = next[at];
+            prev[next[at]] = prev[at];
         }
     }
-    hamilton.push_back(start);
-    return hamilton;
+    vector<uint32_t> tour;
+    if(len == 0)
+        return tour;
+    uint32_t at = kept[walk[0]];
+    do{
+        tour.push_back(walk[at]);
+        at = next[at];
+    } while(at != kept[walk[0]]);
+    return tour;
+}
+
+/**
+ * Weight of an edge for choosing shortcuts, a vertex to itself costs nothing and a missing edge
+ * costs more than any real one
+ * @tparam T is the type of the graph
+ * @param from is the id of one end of the edge
+ * @param to is the id of the other end of the edge
+ * @return the weight of the edge
+ */
+template <typename T>
+long long Chris<T>::shortcutCost(uint32_t from, uint32_t to) const {
+    if(from == to)
+        return 0;
+    int weight = this->getWeight(from, to);
+    return weight == -1 ? INT_MAX : weight;
 }
 #endif //TSP_CHRIS_H
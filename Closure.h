@@ -0,0 +1,291 @@
+/**
+ * Shortest path metric closure of a graph
+ * Every pair of nodes gets the length of the shortest path between them, so a sparse graph
+ * becomes a complete graph that satisfies the triangle inequality. Sparse graphs run one
+ * Dijkstra per source and dense graphs run a blocked Floyd-Warshall, both across a thread
+ * pool. The predecessor of every node on every shortest path is kept so a shortcut between
+ * two nodes can be expanded back into the real edges it stands for
+ */
+
+#ifndef TSP_CLOSURE_H
+#define TSP_CLOSURE_H
+
+#include <vector>
+#include <cstdint>
+#include <climits>
+#include <algorithm>
+#include "various.h"
+#include "IndexedHeap.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+class MetricClosure{
+public:
+    static const uint32_t BLOCK = 64;   // side of a Floyd-Warshall tile
+    bool compute(uint32_t size, const vector<idEdge>& edges, apsp_Type tp = apsp_auto, unsigned threads = 0);
+    void clear();
+    bool isEmpty() const {return n == 0;}
+    uint32_t getNumNodes() const {return n;}
+    int getDistance(uint32_t from, uint32_t to) const;
+    void expand(uint32_t from, uint32_t to, vector<uint32_t>& path) const;
+    static apsp_Type pick(uint32_t size, size_t edges);
+    static size_t bytes(uint32_t size, apsp_Type tp);
+private:
+    static const int INF = INT_MAX / 2;  // small enough that two can be added without overflow
+    uint32_t n = 0;
+    vector<int> dist;       // row i holds the distances from i
+    vector<uint32_t> pred;  // row i holds the node before j on the shortest path from i to j
+    vector<uint32_t> hops;  // edges on each path while Floyd-Warshall runs
+    void dijkstra(const vector<idEdge>& edges, unsigned threads);
+    void floydWarshall(const vector<idEdge>& edges, unsigned threads);
+    void relaxTile(uint32_t iBlock, uint32_t jBlock, uint32_t kBlock);
+    static void relaxRow(int throughK, uint32_t hopsToK, const int* __restrict rowK, const uint32_t* __restrict hopsK,
+                         const uint32_t* __restrict predK, int* __restrict rowI, uint32_t* __restrict hopsI,
+                         uint32_t* __restrict predI, uint32_t count);
+};
+
+/**
+ * Chooses between Dijkstra and Floyd-Warshall from the density of the graph
+ * @param size is the number of nodes
+ * @param edges is the number of edges
+ * @return apsp_dijkstra if the graph is sparse, apsp_floyd otherwise
+ */
+inline apsp_Type MetricClosure::pick(uint32_t size, size_t edges) {
+    // n Dijkstras cost about n * E log n, Floyd-Warshall costs n^3 but streams through memory
+    return static_cast<uint64_t>(edges) * 16 < static_cast<uint64_t>(size) * size ? apsp_dijkstra : apsp_floyd;
+}
+
+/**
+ * Bytes compute takes at its peak, so callers can check a budget before running it
+ * @param size is the number of nodes
+ * @param tp is the algorithm that will run, not apsp_auto
+ * @return the size of the distance and predecessor matrices, plus the hop counts that
+ * Floyd-Warshall keeps while it runs
+ */
+inline size_t MetricClosure::bytes(uint32_t size, apsp_Type tp) {
+    size_t cells = static_cast<size_t>(size) * size;
+    size_t perCell = sizeof(int) + sizeof(uint32_t);
+    if(tp == apsp_floyd)
+        perCell += sizeof(uint32_t);
+    return cells * perCell;
+}
+
+/**
+ * Computes the shortest path between every pair of nodes
+ * @param size is the number of nodes, ids run from 0 to size - 1
+ * @param edges are the undirected edges of the graph, weights must not be negative and paths
+ * longer than INT_MAX / 2 count as missing
+ * @param tp is the algorithm to use, apsp_auto picks one from the density of the graph
+ * @param threads is the number of threads to use, 0 uses every hardware thread
+ * @return true if every pair of nodes is connected
+ */
+inline bool MetricClosure::compute(uint32_t size, const vector<idEdge>& edges, apsp_Type tp, unsigned threads) {
+    n = size;
+    size_t cells = static_cast<size_t>(n) * n;
+    dist.assign(cells, static_cast<int>(INF));   // cast so INF isn't bound to a reference
+    pred.assign(cells, NO_ID);
+    if(tp == apsp_auto)
+        tp = pick(n, edges.size());
+    if(tp == apsp_dijkstra)
+        dijkstra(edges, threads);
+    else
+        floydWarshall(edges, threads);
+    for(size_t i = 0; i < cells; i++)
+        if(dist[i] == INF)
+            return false;
+    return true;
+}
+
+/**
+ * Frees the distance and predecessor matrices
+ */
+inline void MetricClosure::clear() {
+    n = 0;
+    vector<int>().swap(dist);
+    vector<uint32_t>().swap(pred);
+}
+
+/**
+ * Looks up the length of the shortest path between two nodes
+ * @param from is the id of the first node
+ * @param to is the id of the second node
+ * @return the length of the path, -1 if the nodes aren't connected
+ */
+inline int MetricClosure::getDistance(uint32_t from, uint32_t to) const {
+    int d = dist[static_cast<size_t>(from) * n + to];
+    return d == INF ? -1 : d;
+}
+
+/**
+ * Appends the nodes on the shortest path between two nodes, from is left out so the paths
+ * of consecutive pairs can be chained
+ * @param from is the id of the first node
+ * @param to is the id of the last node
+ * @param path is the vector the nodes after from are appended to, ending with to
+ */
+inline void MetricClosure::expand(uint32_t from, uint32_t to, vector<uint32_t>& path) const {
+    const uint32_t* row = pred.data() + static_cast<size_t>(from) * n;
+    size_t first = path.size();
+    for(uint32_t cur = to; cur != from && cur != NO_ID; cur = row[cur])
+        path.push_back(cur);
+    reverse(path.begin() + first, path.end());
+}
+
+/**
+ * Runs Dijkstra from every node, each worker takes a contiguous range of sources and keeps
+ * its own heap
+ * @param edges are the edges of the graph
+ * @param threads is the number of threads to use
+ */
+inline void MetricClosure::dijkstra(const vector<idEdge>& edges, unsigned threads) {
+    // compressed sparse row adjacency, both directions of every edge
+    vector<uint32_t> offsets(n + 1, 0);
+    for(unsigned int i = 0; i < edges.size(); i++){
+        offsets[edges[i].from + 1]++;
+        offsets[edges[i].to + 1]++;
+    }
+    for(uint32_t i = 0; i < n; i++)
+        offsets[i + 1] += offsets[i];
+    vector<uint32_t> adjacency(offsets[n]);
+    vector<int> weights(offsets[n]);
+    vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for(unsigned int i = 0; i < edges.size(); i++){
+        uint32_t pos = fill[edges[i].from]++;
+        adjacency[pos] = edges[i].to;
+        weights[pos] = edges[i].weight;
+        pos = fill[edges[i].to]++;
+        adjacency[pos] = edges[i].from;
+        weights[pos] = edges[i].weight;
+    }
+    ThreadPool pool(threads);
+    pool.parallelFor(0, n, [&](size_t lo, size_t hi, size_t) {
+        IndexedHeap<int> heap(n);
+        for(size_t src = lo; src < hi; src++){
+            int* d = dist.data() + src * n;
+            uint32_t* p = pred.data() + src * n;
+            d[src] = 0;
+            p[src] = static_cast<uint32_t>(src);
+            heap.push(static_cast<uint32_t>(src), 0);
+            while(!heap.empty()){
+                uint32_t cur = heap.pop();
+                for(uint32_t i = offsets[cur]; i < offsets[cur + 1]; i++){
+                    long long next = static_cast<long long>(d[cur]) + weights[i];
+                    uint32_t to = adjacency[i];
+                    if(next < d[to]){
+                        d[to] = static_cast<int>(next);
+                        p[to] = cur;
+                        heap.decrease(to, d[to]);
+                    }
+                }
+            }
+        }
+    });
+}
+
+/**
+ * Runs Floyd-Warshall over BLOCK x BLOCK tiles. For every diagonal tile k the tile itself is
+ * relaxed first, then the tiles in its row and column, then every other tile, and the tiles
+ * in the last two steps don't depend on each other so they are spread across the pool.
+ * Paths of equal length are compared by their number of edges, without that zero weight
+ * edges can leave the predecessors in a cycle
+ * @param edges are the edges of the graph
+ * @param threads is the number of threads to use
+ */
+inline void MetricClosure::floydWarshall(const vector<idEdge>& edges, unsigned threads) {
+    hops.assign(static_cast<size_t>(n) * n, INT_MAX / 2);   // a sum of two still fits in an int
+    for(uint32_t i = 0; i < n; i++){
+        dist[static_cast<size_t>(i) * n + i] = 0;
+        pred[static_cast<size_t>(i) * n + i] = i;
+        hops[static_cast<size_t>(i) * n + i] = 0;
+    }
+    for(unsigned int i = 0; i < edges.size(); i++){ // keeps the lightest of parallel edges
+        const idEdge& ed = edges[i];
+        size_t fwd = static_cast<size_t>(ed.from) * n + ed.to;
+        size_t back = static_cast<size_t>(ed.to) * n + ed.from;
+        if(ed.from != ed.to && ed.weight < dist[fwd]){
+            dist[fwd] = dist[back] = ed.weight;
+            hops[fwd] = hops[back] = 1;
+            pred[fwd] = ed.from;
+            pred[back] = ed.to;
+        }
+    }
+    uint32_t blocks = (n + BLOCK - 1) / BLOCK;
+    ThreadPool pool(threads);
+    for(uint32_t k = 0; k < blocks; k++){
+        relaxTile(k, k, k);
+        pool.parallelFor(0, blocks, [&](size_t lo, size_t hi, size_t) {
+            for(size_t b = lo; b < hi; b++){
+                if(b == k)
+                    continue;
+                relaxTile(k, static_cast<uint32_t>(b), k);
+                relaxTile(static_cast<uint32_t>(b), k, k);
+            }
+        });
+        pool.parallelFor(0, blocks, [&](size_t lo, size_t hi, size_t) {
+            for(size_t i = lo; i < hi; i++){
+                if(i == k)
+                    continue;
+                for(uint32_t j = 0; j < blocks; j++)
+                    if(j != k)
+                        relaxTile(static_cast<uint32_t>(i), j, k);
+            }
+        });
+    }
+    vector<uint32_t>().swap(hops);
+}
+
+/**
+ * Relaxes every pair in one tile through every intermediate node of another
+ * @param iBlock is the tile row of the sources
+ * @param jBlock is the tile column of the destinations
+ * @param kBlock is the tile of the intermediate nodes
+ */
+inline void MetricClosure::relaxTile(uint32_t iBlock, uint32_t jBlock, uint32_t kBlock) {
+    uint32_t iEnd = min(n, (iBlock + 1) * BLOCK);
+    uint32_t jStart = jBlock * BLOCK;
+    uint32_t jEnd = min(n, jStart + BLOCK);
+    uint32_t kEnd = min(n, (kBlock + 1) * BLOCK);
+    for(uint32_t k = kBlock * BLOCK; k < kEnd; k++){
+        const int* rowK = dist.data() + static_cast<size_t>(k) * n;
+        const uint32_t* predK = pred.data() + static_cast<size_t>(k) * n;
+        const uint32_t* hopsK = hops.data() + static_cast<size_t>(k) * n;
+        for(uint32_t i = iBlock * BLOCK; i < iEnd; i++){
+            int* rowI = dist.data() + static_cast<size_t>(i) * n;
+            int throughK = rowI[k];
+            if(throughK == INF || i == k)  // going through itself can't shorten row k
+                continue;
+            uint32_t* predI = pred.data() + static_cast<size_t>(i) * n;
+            uint32_t* hopsI = hops.data() + static_cast<size_t>(i) * n;
+            relaxRow(throughK, hopsI[k], rowK + jStart, hopsK + jStart, predK + jStart, rowI + jStart, hopsI + jStart, predI + jStart, jEnd - jStart);
+        }
+    }
+}
+
+/**
+ * Relaxes part of row i through node k. The rows never overlap, so the loop is written as
+ * selects over restrict pointers and vectorizes
+ * @param throughK is the distance from i to k
+ * @param hopsToK is the number of edges between i and k
+ * @param rowK, hopsK, predK are the distances, edge counts and predecessors from k
+ * @param rowI, hopsI, predI are the distances, edge counts and predecessors from i
+ * @param count is the number of entries to relax
+ */
+inline void MetricClosure::relaxRow(int throughK, uint32_t hopsToK, const int* __restrict rowK, const uint32_t* __restrict hopsK,
+                                    const uint32_t* __restrict predK, int* __restrict rowI, uint32_t* __restrict hopsI,
+                                    uint32_t* __restrict predI, uint32_t count) {
+    for(uint32_t j = 0; j < count; j++){
+        int next = throughK + rowK[j];
+        int nextHops = static_cast<int>(hopsToK + hopsK[j]);
+        int cur = rowI[j];
+        int curHops = static_cast<int>(hopsI[j]);
+        uint32_t nextPred = predK[j];
+        uint32_t curPred = predI[j];
+        int better = (next < cur) | ((next == cur) & (nextHops < curHops));
+        rowI[j] = better ? next : cur;
+        hopsI[j] = static_cast<uint32_t>(better ? nextHops : curHops);
+        predI[j] = better ? nextPred : curPred;
+    }
+}
+
+#endif //TSP_CLOSURE_H
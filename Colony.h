@@ -0,0 +1,333 @@
+/**
+ * MAX-MIN ant system
+ * Every iteration a colony of ants builds tours across the thread pool. An ant picks the next
+ * city among the unvisited candidates of the current one with a chance proportional to the
+ * pheromone on the edge times a power of the inverse weight, and falls back to the nearest
+ * unvisited city when every candidate is taken. The tours get 2-opt and Or-opt, and only the
+ * best one lays pheromone. The pheromone is a flat float matrix laid out like the dense distance
+ * matrix, so evaporation is one vectorized pass that also clamps every trail between the MMAS
+ * bounds. The weights are always read from the graph, never copied. The pheromone is kept
+ * between calls and can be saved to a file, so solving the same instance again starts from what
+ * the last colony learned
+ */
+
+#ifndef TSP_COLONY_H
+#define TSP_COLONY_H
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <algorithm>
+#include "LocalSearch.h"
+#include "ThreadPool.h"
+#include "Kernels.h"
+
+using namespace std;
+
+template <typename T>
+class AntColony : public LocalSearch<T>{
+public:
+    explicit AntColony(Graph<T>& gr) : LocalSearch<T>(gr) {}
+    vector<T> optimize(const vector<T>& path);
+    void setBudget(uint32_t iterations, double seconds) {maxIterations = iterations; maxSeconds = seconds;}
+    void setColony(uint32_t count) {ants = max<uint32_t>(1, count);}
+    void setEvaporation(double rate) {rho = rate;}
+    void setBeta(double value) {beta = value;}
+    void setLocalSearch(bool on) {polish = on;}
+    void setSeed(uint32_t value) {seed = value;}
+    bool savePheromone(const string& fileName) const;
+    bool loadPheromone(const string& fileName);
+    uint32_t getIterations() const {return iterations;}
+    bool isWarm() const {return warm;}
+protected:
+    static const size_t MAX_TRAILS = size_t(1) << 28;   // 1 GiB of floats
+    static const uint32_t TAG = 0x50505354;             // "TSPP" starts a pheromone file
+    uint32_t maxIterations = 0;     // 0 with no time limit runs 100 iterations
+    double maxSeconds = 0;          // 0 has no time limit
+    uint32_t ants = 25;
+    double rho = 0.02;              // part of the pheromone that evaporates every iteration
+    double beta = 2;                // weight of the edge length against the pheromone
+    double pBest = 0.05;            // sets the lower trail bound, as in MMAS
+    bool polish = true;             // runs 2-opt and Or-opt on every ant's tour
+    uint32_t seed = 1;
+    uint32_t iterations = 0;
+    bool warm = false;              // true if the last run started from kept pheromone
+    uint32_t nodes = 0;             // size of the pheromone matrix
+    uint32_t stride = 0;            // floats per row, a multiple of 64 bytes
+    vector<float> block;            // the allocation
+    float* trail = nullptr;         // first aligned float in block
+    vector<float> heuristic;        // inverse weight to the power beta, per candidate
+    vector<float> choice;           // pheromone times heuristic, per candidate
+    void resizeTrails(uint32_t n);
+    void fillTrails(float value);
+    float& trailAt(uint32_t from, uint32_t to) {return trail[static_cast<size_t>(from) * stride + to];}
+    void buildTour(mt19937& rng, vector<uint64_t>& visited, vector<uint32_t>& tour) const;
+    uint32_t nearestUnvisited(uint32_t from, const vector<uint64_t>& visited) const;
+    long long tourLength(const vector<uint32_t>& tour) const;
+};
+
+/**
+ * Runs the colony until the iteration or time budget runs out
+ * @tparam T is the type of the graph
+ * @param path is a closed tour to start from, like the one returned by getPath. It is the best
+ * tour until an ant beats it and sets the starting pheromone when there is none kept
+ * @return the best tour found, or the same one if it doesn't visit every node exactly once
+ */
+template <typename T>
+vector<T> AntColony<T>::optimize(const vector<T>& path) {
+    static const uint32_t GLOBAL = 10;      // every this many iterations the best so far lays pheromone
+    static const uint32_t RESTART = 100;    // iterations without a new best before the trails reset
+    vector<uint32_t> best;
+    iterations = 0;
+    if(!this->toIds(path, best))
+        return path;
+    uint32_t n = static_cast<uint32_t>(best.size());
+    if(static_cast<size_t>(n) * n > MAX_TRAILS) {
+        cout << "Too many nodes for the pheromone matrix, not running the colony" << endl;
+        return path;
+    }
+    auto start = chrono::steady_clock::now();
+    uint32_t budget = maxIterations == 0 && maxSeconds <= 0 ? 100 : maxIterations;
+    long long bestCost = tourLength(best);
+    double decay = pow(pBest, 1.0 / n);
+    double avg = max(2.0, n / 2.0);
+    auto upper = [&]() {return static_cast<float>(1.0 / (rho * bestCost));};
+    auto lower = [&]() {return static_cast<float>(1.0 / (rho * bestCost) * (1 - decay) / ((avg - 1) * decay));};
+    warm = nodes == n;
+    if(!warm) {
+        resizeTrails(n);
+        fillTrails(upper());
+    }
+    uint32_t k = this->cand.getK();
+    heuristic.assign(static_cast<size_t>(n) * k, 0);
+    choice.assign(static_cast<size_t>(n) * k, 0);
+    for(uint32_t i = 0; i < n; i++){
+        for(uint32_t c = 0; c < this->cand.count(i); c++)
+            heuristic[static_cast<size_t>(i) * k + c] =
+                static_cast<float>(pow(1.0 / max<long long>(1, this->dist(i, this->cand.get(i)[c])), beta));
+    }
+    ThreadPool pool(this->threads);
+    vector<vector<uint32_t>> tours(ants);
+    vector<long long> costs(ants);
+    uint32_t stall = 0;
+    while(budget == 0 || iterations < budget){
+        if(maxSeconds > 0 && chrono::duration<double>(chrono::steady_clock::now() - start).count() >= maxSeconds)
+            break;
+        for(uint32_t i = 0; i < n; i++){
+            for(uint32_t c = 0; c < this->cand.count(i); c++)
+                choice[static_cast<size_t>(i) * k + c] = trailAt(i, this->cand.get(i)[c]) * heuristic[static_cast<size_t>(i) * k + c];
+        }
+        pool.parallelFor(0, ants, [&](size_t lo, size_t hi, unsigned) {
+            LocalSearch<T> search(this->graph);
+            search.setCandidates(this->cand);
+            vector<uint64_t> visited;
+            for(size_t a = lo; a < hi; a++){
+                // every ant gets its own stream, so the split into chunks doesn't matter
+                seed_seq mix{seed, iterations, static_cast<uint32_t>(a)};
+                mt19937 rng(mix);
+                buildTour(rng, visited, tours[a]);
+                if(polish) {
+                    vector<T> improved = search.improve(this->toPath(tours[a]));
+                    for(uint32_t i = 0; i < n; i++)
+                        tours[a][i] = this->graph.getId(improved[i]);
+                }
+                costs[a] = tourLength(tours[a]);
+            }
+        });
+        iterations++;
+        uint32_t round = static_cast<uint32_t>(min_element(costs.begin(), costs.end()) - costs.begin());
+        if(costs[round] < bestCost) {
+            bestCost = costs[round];
+            best = tours[round];
+            stall = 0;
+        }
+        else if(++stall >= RESTART) {
+            fillTrails(upper());
+            stall = 0;
+            continue;
+        }
+        float hi = upper(), lo = min(lower(), hi);
+        scaleClamp(trail, static_cast<size_t>(n) * stride, static_cast<float>(1 - rho), lo, hi);
+        const vector<uint32_t>& layer = iterations % GLOBAL == 0 ? best : tours[round];
+        float amount = static_cast<float>(1.0 / (iterations % GLOBAL == 0 ? bestCost : costs[round]));
+        for(uint32_t i = 0; i < n; i++){
+            uint32_t u = layer[i], v = layer[(i + 1) % n];
+            float value = min(trailAt(u, v) + amount, hi);
+            trailAt(u, v) = value;
+            trailAt(v, u) = value;
+        }
+    }
+    return this->toPath(best);
+}
+
+/**
+ * Builds one ant's tour
+ * @tparam T is the type of the graph
+ * @param rng picks the first city and every step
+ * @param visited is the ant's bitmap, reset here
+ * @param tour is set to the ids of the tour, without returning to the start
+ */
+template <typename T>
+void AntColony<T>::buildTour(mt19937& rng, vector<uint64_t>& visited, vector<uint32_t>& tour) const {
+    uint32_t n = nodes, k = this->cand.getK();
+    uniform_real_distribution<float> unit(0.0f, 1.0f);
+    visited.assign((n + 63) / 64, 0);
+    tour.clear();
+    uint32_t cur = rng() % n;
+    while(true){
+        tour.push_back(cur);
+        visited[cur >> 6] |= uint64_t(1) << (cur & 63);
+        if(tour.size() == n)
+            break;
+        const uint32_t* near = this->cand.get(cur);
+        const float* weights = choice.data() + static_cast<size_t>(cur) * k;
+        float sum = 0;
+        uint32_t last = NO_ID;
+        for(uint32_t c = 0; c < this->cand.count(cur); c++){
+            if(!testBit(visited.data(), near[c])) {
+                sum += weights[c];
+                last = near[c];
+            }
+        }
+        uint32_t next = last;
+        if(sum > 0) {
+            float r = unit(rng) * sum;
+            for(uint32_t c = 0; c < this->cand.count(cur); c++){
+                if(testBit(visited.data(), near[c]))
+                    continue;
+                r -= weights[c];
+                if(r <= 0) {
+                    next = near[c];
+                    break;
+                }
+            }
+        }
+        cur = next == NO_ID ? nearestUnvisited(cur, visited) : next;
+    }
+}
+
+/**
+ * Finds the closest city an ant hasn't visited, scanning the row of the dense matrix with the
+ * vectorized argmin when there is one
+ * @tparam T is the type of the graph
+ * @param from is the city the ant is at
+ * @param visited is the ant's bitmap
+ * @return the id of the closest unvisited city, connected or not
+ */
+template <typename T>
+uint32_t AntColony<T>::nearestUnvisited(uint32_t from, const vector<uint64_t>& visited) const {
+    uint32_t n = nodes, best = NO_ID;
+    if(this->graph.isDense()) {
+        const DistMatrix& matrix = this->graph.getMatrix();
+        if(matrix.getType() == m_int16)
+            best = maskedArgmin(matrix.row<int16_t>(from), visited.data(), n);
+        else if(matrix.getType() == m_float)
+            best = maskedArgmin(matrix.row<float>(from), visited.data(), n);
+        else
+            best = maskedArgmin(matrix.row<int32_t>(from), visited.data(), n);
+        if(best != NO_ID)
+            return best;
+    }
+    long long bestWeight = LLONG_MAX;
+    for(uint32_t j = 0; j < n; j++){
+        if(!testBit(visited.data(), j) && this->dist(from, j) < bestWeight) {
+            bestWeight = this->dist(from, j);
+            best = j;
+        }
+    }
+    return best;
+}
+
+/**
+ * @tparam T is the type of the graph
+ * @param tour is the ids of a tour, without returning to the start
+ * @return the length of the tour, a missing edge costs more than any real one
+ */
+template <typename T>
+long long AntColony<T>::tourLength(const vector<uint32_t>& tour) const {
+    long long sum = 0;
+    for(size_t i = 0; i < tour.size(); i++)
+        sum += this->dist(tour[i], tour[(i + 1) % tour.size()]);
+    return sum;
+}
+
+/**
+ * Allocates the pheromone matrix with every row on a 64 byte boundary
+ * @tparam T is the type of the graph
+ * @param n is the number of nodes
+ */
+template <typename T>
+void AntColony<T>::resizeTrails(uint32_t n) {
+    const size_t perLine = DistMatrix::ALIGN / sizeof(float);
+    nodes = n;
+    stride = static_cast<uint32_t>((n + perLine - 1) / perLine * perLine);
+    block.assign(static_cast<size_t>(n) * stride + perLine, 0);
+    size_t skip = (DistMatrix::ALIGN - reinterpret_cast<uintptr_t>(block.data()) % DistMatrix::ALIGN) % DistMatrix::ALIGN;
+    trail = block.data() + skip / sizeof(float);
+}
+
+/**
+ * Sets every trail to the same amount
+ * @tparam T is the type of the graph
+ * @param value is the amount of pheromone
+ */
+template <typename T>
+void AntColony<T>::fillTrails(float value) {
+    fill(trail, trail + static_cast<size_t>(nodes) * stride, value);
+}
+
+/**
+ * Writes the pheromone matrix to a binary file: a tag, the node count, the fingerprint of the
+ * graph, then the rows
+ * @tparam T is the type of the graph
+ * @param fileName is the file to write
+ * @return false if there is no pheromone or the file can't be written
+ */
+template <typename T>
+bool AntColony<T>::savePheromone(const string& fileName) const {
+    if(nodes == 0)
+        return false;
+    ofstream file(fileName, ios::binary);
+    if(!file.is_open())
+        return false;
+    uint32_t tag = TAG;
+    uint64_t key = CandidateSet::fingerprint(this->graph);
+    file.write(reinterpret_cast<const char*>(&tag), sizeof(tag));
+    file.write(reinterpret_cast<const char*>(&nodes), sizeof(nodes));
+    file.write(reinterpret_cast<const char*>(&key), sizeof(key));
+    for(uint32_t i = 0; i < nodes; i++)
+        file.write(reinterpret_cast<const char*>(trail + static_cast<size_t>(i) * stride), sizeof(float) * nodes);
+    return file.good();
+}
+
+/**
+ * Reads a pheromone matrix written by savePheromone, so the next run starts from it. It is
+ * only used if it was saved for the same graph, trails from another graph with as many nodes
+ * mean nothing here
+ * @tparam T is the type of the graph
+ * @param fileName is the file to read
+ * @return false if the file can't be read or was saved for a different graph
+ */
+template <typename T>
+bool AntColony<T>::loadPheromone(const string& fileName) {
+    ifstream file(fileName, ios::binary);
+    uint32_t tag = 0, n = 0;
+    uint64_t key = 0;
+    if(!file.is_open() || !file.read(reinterpret_cast<char*>(&tag), sizeof(tag)) || tag != TAG
+       || !file.read(reinterpret_cast<char*>(&n), sizeof(n)) || n != this->graph.getNumNodes()
+       || static_cast<size_t>(n) * n > MAX_TRAILS || !file.read(reinterpret_cast<char*>(&key), sizeof(key))
+       || key != CandidateSet::fingerprint(this->graph))
+        return false;
+    resizeTrails(n);
+    for(uint32_t i = 0; i < n; i++){
+        if(!file.read(reinterpret_cast<char*>(trail + static_cast<size_t>(i) * stride), sizeof(float) * n)) {
+            nodes = 0;
+            return false;
+        }
+    }
+    return true;
+}
+
+#endif //TSP_COLONY_H
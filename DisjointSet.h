@@ -0,0 +1,157 @@
+/**
+ * Disjoint set forest over dense node ids
+ * Uses path halving and union by rank, so any sequence of operations runs in
+ * nearly linear time
+ */
+
+#ifndef TSP_DISJOINTSET_H
+#define TSP_DISJOINTSET_H
+
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+
+using namespace std;
+
+class DisjointSet{
+public:
+    explicit DisjointSet(uint32_t size = 0) {reset(size);}
+    void reset(uint32_t size);
+    uint32_t find(uint32_t id);
+    uint32_t findRoot(uint32_t id) const;
+    bool union_(uint32_t first, uint32_t second);
+    bool connected(uint32_t first, uint32_t second) {return find(first) == find(second);}
+    uint32_t getCount() const {return count;}
+private:
+    vector<uint32_t> parent;
+    vector<uint8_t> rank;
+    uint32_t count;    // number of disjoint sets
+};
+
+/**
+ * Puts every id from 0 to size - 1 in its own set
+ * @param size is the number of ids
+ */
+inline void DisjointSet::reset(uint32_t size) {
+    parent.resize(size);
+    for(uint32_t i = 0; i < size; i++)
+        parent[i] = i;
+    rank.assign(size, 0);
+    count = size;
+}
+
+/**
+ * Finds the representative of the set an id is in, pointing every other node on the way
+ * at its grandparent
+ * @param id is the id to look for
+ * @return the id of the set's representative
+ */
+inline uint32_t DisjointSet::find(uint32_t id) {
+    while(parent[id] != id){
+        parent[id] = parent[parent[id]];
+        id = parent[id];
+    }
+    return id;
+}
+
+/**
+ * Finds the representative of the set an id is in without compressing the path, so many
+ * threads can call it at once as long as nothing is being merged
+ * @param id is the id to look for
+ * @return the id of the set's representative
+ */
+inline uint32_t DisjointSet::findRoot(uint32_t id) const {
+    while(parent[id] != id)
+        id = parent[id];
+    return id;
+}
+
+/**
+ * Merges the sets containing two ids, hanging the shallower tree under the deeper one
+ * @param first is an id in the first set
+ * @param second is an id in the second set
+ * @return true if the ids were in different sets
+ */
+inline bool DisjointSet::union_(uint32_t first, uint32_t second) {
+    uint32_t one = find(first);
+    uint32_t two = find(second);
+    if(one == two)
+        return false;
+    if(rank[one] < rank[two])
+        swap(one, two);
+    parent[two] = one;
+    if(rank[one] == rank[two])
+        rank[one]++;
+    count--;
+    return true;
+}
+
+/**
+ * Lock free disjoint set forest that many threads can find and union in at once
+ * Roots are linked by id, the larger root always hangs under the smaller one, so links
+ * can never form a cycle no matter how unions interleave
+ */
+class ConcurrentDisjointSet{
+public:
+    explicit ConcurrentDisjointSet(uint32_t size = 0) {reset(size);}
+    void reset(uint32_t size);
+    uint32_t find(uint32_t id);
+    bool union_(uint32_t first, uint32_t second);
+    uint32_t getSize() const {return size;}
+private:
+    unique_ptr<atomic<uint32_t>[]> parent;
+    uint32_t size;
+};
+
+/**
+ * Puts every id from 0 to count - 1 in its own set, must not run alongside other calls
+ * @param count is the number of ids
+ */
+inline void ConcurrentDisjointSet::reset(uint32_t count) {
+    size = count;
+    parent.reset(new atomic<uint32_t>[count]);
+    for(uint32_t i = 0; i < count; i++)
+        parent[i].store(i, memory_order_relaxed);
+}
+
+/**
+ * Finds the representative of the set an id is in, halving the path on the way. A failed
+ * halving just means another thread already moved the node closer to its root
+ * @param id is the id to look for
+ * @return the id of the set's representative
+ */
+inline uint32_t ConcurrentDisjointSet::find(uint32_t id) {
+    while(true){
+        uint32_t up = parent[id].load(memory_order_acquire);
+        if(up == id)
+            return id;
+        uint32_t grand = parent[up].load(memory_order_acquire);
+        if(up != grand)
+            parent[id].compare_exchange_weak(up, grand, memory_order_release, memory_order_relaxed);
+        id = grand;
+    }
+}
+
+/**
+ * Merges the sets containing two ids
+ * @param first is an id in the first set
+ * @param second is an id in the second set
+ * @return true if this call joined two different sets
+ */
+inline bool ConcurrentDisjointSet::union_(uint32_t first, uint32_t second) {
+    while(true){
+        uint32_t one = find(first);
+        uint32_t two = find(second);
+        if(one == two)
+            return false;
+        if(one < two)
+            swap(one, two);
+        // one may have been linked by another thread since it was found, then try again
+        uint32_t expected = one;
+        if(parent[one].compare_exchange_strong(expected, two, memory_order_acq_rel))
+            return true;
+    }
+}
+
+#endif //TSP_DISJOINTSET_H
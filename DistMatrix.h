@@ -0,0 +1,236 @@
+/**
+ * Flat distance matrix for dense graphs
+ * Rows are stored back to back in one 64 byte aligned block and every row starts on a
+ * 64 byte boundary, so a row can be streamed with aligned vector loads. The element type
+ * is chosen at runtime so large instances can trade precision for cache space
+ */
+
+#ifndef TSP_DISTMATRIX_H
+#define TSP_DISTMATRIX_H
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <limits>
+#include "various.h"
+
+using namespace std;
+
+class DistMatrix{
+public:
+    static const size_t ALIGN = 64;
+    DistMatrix() : n(0), stride(0), type(m_int32), block(nullptr), data(nullptr) {}
+    DistMatrix(const DistMatrix& other);
+    DistMatrix& operator=(const DistMatrix& other);
+    ~DistMatrix() {delete[] block;}
+    void resize(uint32_t size, matrix_Type tp);
+    void grow(uint32_t size);
+    void clear();
+    bool fits(int weight) const {return fits(weight, type);}
+    static bool fits(int weight, matrix_Type tp);
+    static size_t bytesFor(uint32_t size, matrix_Type tp);
+    void set(uint32_t from, uint32_t to, int weight);
+    void setMin(uint32_t from, uint32_t to, int weight);
+    int get(uint32_t from, uint32_t to) const;
+    uint32_t getSize() const {return n;}
+    uint32_t getStride() const {return stride;}
+    matrix_Type getType() const {return type;}
+    template <typename W>
+    const W* row(uint32_t i) const {return reinterpret_cast<const W*>(data) + static_cast<size_t>(i) * stride;}
+    template <typename W>
+    static W missing() {return numeric_limits<W>::max();}
+private:
+    uint32_t n;
+    uint32_t stride;    // elements per row, padded to a multiple of 64 bytes
+    matrix_Type type;
+    unsigned char* block;   // the allocation
+    unsigned char* data;    // first aligned byte in block
+    size_t elemSize() const {return elemSize(type);}
+    static size_t elemSize(matrix_Type tp);
+    size_t bytes() const {return static_cast<size_t>(n) * stride * elemSize();}
+    template <typename W>
+    W* mutableRow(uint32_t i) {return reinterpret_cast<W*>(data) + static_cast<size_t>(i) * stride;}
+    template <typename W>
+    void fill();
+};
+
+/**
+ * Copies another matrix into a new aligned block
+ * @param other is the matrix to copy
+ */
+inline DistMatrix::DistMatrix(const DistMatrix& other) : n(0), stride(0), type(m_int32), block(nullptr), data(nullptr) {
+    *this = other;
+}
+
+/**
+ * Copies another matrix into a new aligned block
+ * @param other is the matrix to copy
+ * @return this matrix
+ */
+inline DistMatrix& DistMatrix::operator=(const DistMatrix& other) {
+    if(this == &other)
+        return *this;
+    clear();
+    n = other.n;
+    stride = other.stride;
+    type = other.type;
+    if(other.data != nullptr){
+        block = new unsigned char[bytes() + ALIGN];
+        data = block + (ALIGN - reinterpret_cast<uintptr_t>(block) % ALIGN) % ALIGN;
+        memcpy(data, other.data, bytes());
+    }
+    return *this;
+}
+
+/**
+ * Size in bytes of one element
+ * @param tp is the element type
+ * @return the element size
+ */
+inline size_t DistMatrix::elemSize(matrix_Type tp) {
+    if(tp == m_int16)
+        return sizeof(int16_t);
+    if(tp == m_float)
+        return sizeof(float);
+    return sizeof(int32_t);
+}
+
+/**
+ * Bytes a matrix takes, padding included, so callers can check a budget before allocating
+ * @param size is the number of nodes
+ * @param tp is the element type
+ * @return the size of the matrix in bytes
+ */
+inline size_t DistMatrix::bytesFor(uint32_t size, matrix_Type tp) {
+    size_t perLine = ALIGN / elemSize(tp);
+    return static_cast<size_t>(size) * ((size + perLine - 1) / perLine * perLine) * elemSize(tp);
+}
+
+/**
+ * Frees the matrix
+ */
+inline void DistMatrix::clear() {
+    delete[] block;
+    block = nullptr;
+    data = nullptr;
+    n = 0;
+    stride = 0;
+}
+
+/**
+ * Allocates a size x size matrix where every pair is unconnected
+ * @param size is the number of nodes
+ * @param tp is the element type
+ */
+inline void DistMatrix::resize(uint32_t size, matrix_Type tp) {
+    clear();
+    n = size;
+    type = tp;
+    size_t perLine = ALIGN / elemSize();
+    stride = static_cast<uint32_t>((n + perLine - 1) / perLine * perLine);
+    if(n == 0)
+        return;
+    block = new unsigned char[bytes() + ALIGN];
+    data = block + (ALIGN - reinterpret_cast<uintptr_t>(block) % ALIGN) % ALIGN;
+    if(type == m_int16)
+        fill<int16_t>();
+    else if(type == m_float)
+        fill<float>();
+    else
+        fill<int32_t>();
+}
+
+/**
+ * Grows the matrix to more nodes, keeping the weights already stored. Every row is copied,
+ * so nodes should be added before the edges
+ * @param size is the new number of nodes
+ */
+inline void DistMatrix::grow(uint32_t size) {
+    DistMatrix bigger;
+    bigger.resize(size, type);
+    for(uint32_t i = 0; i < n && i < size; i++)
+        memcpy(bigger.data + static_cast<size_t>(i) * bigger.stride * elemSize(), data + static_cast<size_t>(i) * stride * elemSize(), min(n, size) * elemSize());
+    swap(n, bigger.n);
+    swap(stride, bigger.stride);
+    swap(block, bigger.block);
+    swap(data, bigger.data);
+}
+
+/**
+ * Marks every pair as unconnected
+ * @tparam W is the element type
+ */
+template <typename W>
+void DistMatrix::fill() {
+    W* first = mutableRow<W>(0);
+    for(size_t i = 0; i < static_cast<size_t>(n) * stride; i++)
+        first[i] = missing<W>();
+}
+
+/**
+ * Checks if a weight can be stored exactly in an element type
+ * @param weight is the weight to check
+ * @param tp is the element type
+ * @return true if it fits, the largest value is reserved for missing edges
+ */
+inline bool DistMatrix::fits(int weight, matrix_Type tp) {
+    if(tp == m_int16)
+        return weight >= numeric_limits<int16_t>::min() && weight < numeric_limits<int16_t>::max();
+    if(tp == m_float)
+        return abs(weight) <= (1 << 24);
+    return weight < numeric_limits<int32_t>::max();
+}
+
+/**
+ * Sets the weight between two nodes in both directions
+ * @param from is the id of one node
+ * @param to is the id of the other node
+ * @param weight is the weight of the edge
+ */
+inline void DistMatrix::set(uint32_t from, uint32_t to, int weight) {
+    if(type == m_int16){
+        mutableRow<int16_t>(from)[to] = static_cast<int16_t>(weight);
+        mutableRow<int16_t>(to)[from] = static_cast<int16_t>(weight);
+    }
+    else if(type == m_float){
+        mutableRow<float>(from)[to] = static_cast<float>(weight);
+        mutableRow<float>(to)[from] = static_cast<float>(weight);
+    }
+    else{
+        mutableRow<int32_t>(from)[to] = weight;
+        mutableRow<int32_t>(to)[from] = weight;
+    }
+}
+
+/**
+ * Sets the weight between two nodes unless a lighter edge is already stored
+ * @param from is the id of one node
+ * @param to is the id of the other node
+ * @param weight is the weight of the edge
+ */
+inline void DistMatrix::setMin(uint32_t from, uint32_t to, int weight) {
+    int cur = get(from, to);
+    if(cur == -1 || weight < cur)
+        set(from, to, weight);
+}
+
+/**
+ * Gets the weight between two nodes
+ * @param from is the id of one node
+ * @param to is the id of the other node
+ * @return the weight, -1 if the nodes are not connected
+ */
+inline int DistMatrix::get(uint32_t from, uint32_t to) const {
+    if(type == m_int16){
+        int16_t w = row<int16_t>(from)[to];
+        return w == missing<int16_t>() ? -1 : w;
+    }
+    if(type == m_float){
+        float w = row<float>(from)[to];
+        return w == missing<float>() ? -1 : static_cast<int>(lround(w));
+    }
+    int32_t w = row<int32_t>(from)[to];
+    return w == missing<int32_t>() ? -1 : w;
+}
+
+#endif //TSP_DISTMATRIX_H
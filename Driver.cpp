@@ -5,11 +5,76 @@
 #include "Driver.h"
 #include "NN.h"
 #include "Chris.h"
-#include "Set.h"
+#include "LocalSearch.h"
+#include "LK.h"
+#include "Partition.h"
+#include "Anneal.h"
+#include "Genetic.h"
+#include "Colony.h"
+#include "HeldKarp.h"
+#include "Exact.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 
+// tours at least this long are kept in a TwoLevelTour, below it an ArrayTour reverses faster
+static const uint32_t TWO_LEVEL_NODES = 50000;
+// alpha-nearness lists find good edges with far fewer neighbors than nearest neighbor lists
+static const uint32_t ALPHA_NEIGHBORS = 5;
+
+/**
+ * Runs the chosen local search on a tour
+ * @tparam TourType is the tour representation the search works on
+ * @param gr is the graph the tour is on
+ * @param improve is the local search to run
+ * @param threads is the number of threads to use, 0 uses every hardware thread
+ * @param cands are the candidate lists to search, empty for the nearest neighbors
+ * @param vec is the tour to improve
+ * @return the improved tour
+ */
+template <typename TourType>
+static vector<string> runImprove(Graph<string>& gr, improve_Type improve, unsigned threads, const CandidateSet& cands, const vector<string>& vec) {
+    if(improve == i_parallel) {
+        PartitionSearch<string, TourType> search(gr);
+        search.setThreads(threads);
+        if(!cands.isEmpty())
+            search.setCandidates(cands);
+        return search.optimize(vec);
+    }
+    LocalSearch<string, TourType> search(gr);
+    search.setThreads(threads);
+    if(!cands.isEmpty())
+        search.setCandidates(cands);
+    if(improve == i_twoOpt)
+        return search.twoOpt(vec);
+    else if(improve == i_orOpt)
+        return search.orOpt(vec);
+    else
+        return search.improve(vec);
+}
+
+/**
+ * Runs LK on a tour
+ * @tparam TourType is the tour representation the search works on
+ * @param gr is the graph the tour is on
+ * @param kicks is the kick budget, 0 kicks once per node
+ * @param seconds is the time budget, 0 has no time limit
+ * @param cands are the candidate lists to search, empty for the nearest neighbors
+ * @param vec is the tour to improve
+ * @param done is set to the number of kicks run
+ * @return the improved tour
+ */
+template <typename TourType>
+static vector<string> runLK(Graph<string>& gr, uint32_t kicks, double seconds, const CandidateSet& cands, const vector<string>& vec, uint32_t& done) {
+    LK<string, TourType> engine(gr);
+    engine.setBudget(kicks, seconds);
+    if(!cands.isEmpty())
+        engine.setCandidates(cands);
+    vector<string> result = engine.optimize(vec);
+    done = engine.getKicks();
+    return result;
+}
+
 /**
  * sets the type of algo to be used
  * @param type
@@ -17,10 +82,74 @@
 void Driver::setType(const string& tp) {
     if(tp == "trivial")
         type = trivial;
+    else if(tp == "multistart")
+        type = multistart;
+    else if(tp == "lk")
+        type = lk;
+    else if(tp == "anneal")
+        type = anneal;
+    else if(tp == "ga")
+        type = genetic;
+    else if(tp == "aco")
+        type = colony;
+    else if(tp == "exact")
+        type = exact;
     else
         type = optimal;
 }
 
+/**
+ * sets how the annealing temperature falls
+ * @param tp is "linear", anything else cools geometrically
+ */
+void Driver::setCooling(const string& tp) {
+    if(tp == "linear")
+        cooling = c_linear;
+    else
+        cooling = c_geometric;
+}
+
+/**
+ * sets the algo that builds the tour LK, annealing and the ant colony start from, which the
+ * genetic algorithm also puts in its population
+ * @param tp is "trivial", "multistart", anything else uses Christofides
+ */
+void Driver::setWarmStart(const string& tp) {
+    if(tp == "trivial")
+        warmStart = trivial;
+    else if(tp == "multistart")
+        warmStart = multistart;
+    else
+        warmStart = optimal;
+}
+
+/**
+ * sets the local search run on the finished tour
+ * @param tp is "2opt", "oropt" or "2opt+oropt" to interleave both, "parallel" runs both on
+ * parts of the tour across threads, anything else turns it off
+ */
+void Driver::setImprove(const string& tp) {
+    if(tp == "2opt")
+        improve = i_twoOpt;
+    else if(tp == "oropt")
+        improve = i_orOpt;
+    else if(tp == "2opt+oropt")
+        improve = i_both;
+    else if(tp == "parallel")
+        improve = i_parallel;
+    else
+        improve = i_none;
+}
+
+/**
+ * sets the candidate lists the improvement engines search
+ * @param tp is "alpha" for alpha-nearness from a minimum 1-tree, anything else uses the
+ * nearest neighbors
+ */
+void Driver::setCandidates(const string& tp) {
+    alphaCandidates = tp == "alpha";
+}
+
 /**
  * Sets the output file
  * @param fileName is the name of the output file
@@ -46,10 +175,18 @@ void Driver::readFile(const string& fileName) {
         cout << "Set type first" << endl;
         return;
     }
-    if(type == trivial)
-        gr = new NN<string>();
+    delete gr;
+    algo_Type build = type == trivial || type == optimal || type == multistart ? type : warmStart;    // the algo that builds the first tour
+    NN<string>* nn = nullptr;
+    if(build == trivial || build == multistart) {
+        nn = new NN<string>();
+        if(build == multistart)
+            nn->setStarts(0);   // every node
+        gr = nn;
+    }
     else
         gr = new Chris<string>();
+    gr->setThreads(threads);
     ifstream inputFile(fileName);
     if(!inputFile.is_open()){
         cout << "Error in input file" << endl;
@@ -68,6 +205,9 @@ void Driver::readFile(const string& fileName) {
     string numConnections;
     getline(inputFile, numConnections);
     int numCon = parseInt(numConnections);
+    // a file with an edge for every pair is read straight into the distance matrix
+    if(numNodes > 1 && static_cast<uint64_t>(numCon) * 2 >= static_cast<uint64_t>(numNodes) * (numNodes - 1))
+        gr->setStorage(s_dense);
     for(int j = 0; j < numCon; j++){    //adds all the edges
         getline(inputFile, line);
         if(line.length() <= 0)
@@ -84,23 +224,169 @@ void Driver::readFile(const string& fileName) {
         if(inputFile.eof())
             break;
     }
-    // gets the path
-    vector<string> vec = gr->getPath();
+    // both solvers need every pair of nodes connected, so sparse graphs are solved over their
+    // shortest path closure and the tour is expanded back into real edges. Without one there
+    // is no tour to write
+    if(!gr->isComplete() && !gr->closeMetric())
+        return;
+    // gets the path, small graphs are solved exactly when the subset table fits in memory
+    Exact<string> dp(*gr);
+    dp.setThreads(threads);
+    bool solved = (type == exact || type == optimal) && dp.fits();
+    if(type == exact && !solved)
+        cout << "Too many nodes for the exact solver" << endl;
+    vector<string> vec;
+    if(solved)
+        vec = dp.solve();
+    if(vec.empty()) {
+        solved = false;
+        vec = gr->getPath();
+    }
+    improve_Type polish = solved ? i_none : improve;    // an optimal tour can't be improved
+    bool large = gr->getNumNodes() >= TWO_LEVEL_NODES;
+    // the Held-Karp ascent gives the lower bound, and its penalties make alpha-nearness sharper
+    HeldKarp<string> hk(*gr);
+    hk.setThreads(threads);
+    bool bounded = lowerBound || gapTarget > 0;
+    long long lower = bounded ? hk.bound(gr->calcWeights(vec)) : 0;
+    bool skipImprove = gapTarget > 0 && gap(gr->calcWeights(vec), lower) <= gapTarget;
+    bool skipEngine = skipImprove;
+    CandidateSet cands;     // left empty, every engine builds its own nearest neighbor lists
+    bool cached = false;
+    if(alphaCandidates && !skipImprove && (polish != i_none || type == lk || type == anneal || type == genetic || type == colony)) {
+        uint64_t key = candidateFile.empty() ? 0 : CandidateSet::fingerprint(*gr);
+        cached = !candidateFile.empty() && cands.load(candidateFile, key) && cands.getNumNodes() == gr->getNumNodes()
+                 && cands.getK() == min(ALPHA_NEIGHBORS, gr->getNumNodes() - 1);
+        if(!cached) {
+            if(!bounded)
+                hk.bound(gr->calcWeights(vec));
+            cands.buildAlpha(*gr, ALPHA_NEIGHBORS, threads, hk.getPenalties());
+            if(!candidateFile.empty() && !cands.save(candidateFile, key))
+                cout << "Error writing candidate file" << endl;
+        }
+    }
+    if(polish != i_none && !skipImprove) {
+        vec = large ? runImprove<TwoLevelTour>(*gr, polish, threads, cands, vec)
+                    : runImprove<ArrayTour>(*gr, polish, threads, cands, vec);
+        skipEngine = gapTarget > 0 && gap(gr->calcWeights(vec), lower) <= gapTarget;
+    }
+    uint32_t kicks = 0, reheats = 0, generations = 0, iterations = 0;
+    bool warm = false;
+    uint64_t moves = 0;
+    algo_Type run = skipEngine ? build : type;     // no engine once the tour is close enough to the bound
+    if(run == lk)
+        vec = large ? runLK<TwoLevelTour>(*gr, budgetCount, budgetSeconds, cands, vec, kicks)
+                    : runLK<ArrayTour>(*gr, budgetCount, budgetSeconds, cands, vec, kicks);
+    else if(run == anneal) {
+        Annealer<string> annealer(*gr);
+        if(!cands.isEmpty())
+            annealer.setCandidates(cands);
+        annealer.setBudget(budgetCount, budgetSeconds);
+        annealer.setSchedule(cooling);
+        vec = annealer.optimize(vec);
+        moves = annealer.getMoves();
+        reheats = annealer.getReheats();
+    }
+    else if(run == genetic) {
+        Genetic<string> ga(*gr);
+        ga.setThreads(threads);
+        if(!cands.isEmpty())
+            ga.setCandidates(cands);
+        ga.setLimits(budgetCount, population, budgetSeconds);
+        vec = ga.optimize(vector<vector<string>>(1, vec));
+        generations = ga.getGenerations();
+    }
+    else if(run == colony) {
+        AntColony<string> aco(*gr);
+        aco.setThreads(threads);
+        if(!cands.isEmpty())
+            aco.setCandidates(cands);
+        aco.setBudget(budgetCount, budgetSeconds);
+        if(!pheromoneFile.empty())
+            aco.loadPheromone(pheromoneFile);
+        vec = aco.optimize(vec);
+        iterations = aco.getIterations();
+        warm = aco.isWarm();
+        if(!pheromoneFile.empty() && !aco.savePheromone(pheromoneFile))
+            cout << "Error writing pheromone file" << endl;
+    }
+    vec = gr->expandPath(vec);
     *out << "Ideal path for " << fileName <<  " using ";
-    if(type == trivial) {
+    if(solved) {
+        *out << "Held-Karp exact DP";
+    }
+    else if(build == trivial) {
         *out << "NN";
     }
+    else if(build == multistart) {
+        *out << "multi-start NN";
+    }
     else {
         *out << "Christofides";
     }
+    if(polish == i_twoOpt)
+        *out << " + 2-opt";
+    else if(polish == i_orOpt)
+        *out << " + Or-opt";
+    else if(polish == i_both)
+        *out << " + 2-opt/Or-opt";
+    else if(polish == i_parallel)
+        *out << " + parallel 2-opt/Or-opt";
+    if(type == lk)
+        *out << " + LK";
+    else if(type == anneal)
+        *out << " + annealing";
+    else if(type == genetic)
+        *out << " + EAX genetic algorithm";
+    else if(type == colony)
+        *out << " + MMAS ant colony";
     *out << " implementation:" << endl;
-    *out << "Cost: " << gr->calcWeights(vec) << endl;
+    int cost = gr->calcWeights(vec);
+    *out << "Cost: " << cost << endl;
+    if(bounded) {
+        // a 1-tree that is a tour proves the bound is the shortest tour, even if this one isn't it
+        *out << "Lower bound: " << lower << ", gap: " << gap(cost, lower) << "%";
+        if(cost == lower)
+            *out << ", optimal";
+        else if(hk.isTour())
+            *out << ", bound is tight";
+        *out << endl;
+        if((skipImprove && polish != i_none) || run != type)
+            *out << "Gap under " << gapTarget << "%, stopped improving" << endl;
+    }
+    if(build == multistart) {
+        const costSpread& spread = nn->getSpread();
+        *out << "Spread over " << spread.runs << " starts: best " << spread.best << ", worst " << spread.worst
+             << ", mean " << spread.mean << ", std dev " << spread.stdDev << endl;
+    }
+    if(!cands.isEmpty())
+        *out << "Alpha-nearness candidates: " << cands.getK() << " per node" << (cached ? ", loaded from cache" : "") << endl;
+    if(type == lk)
+        *out << "LK kicks: " << kicks << endl;
+    else if(type == anneal)
+        *out << "Annealing moves: " << moves << ", reheats: " << reheats << endl;
+    else if(type == genetic)
+        *out << "GA generations: " << generations << endl;
+    else if(type == colony)
+        *out << "ACO iterations: " << iterations << (warm ? ", warm started" : "") << endl;
     // prints the path
     printVec(vec);
     out->flush();
     inputFile.close();
 }
 
+/**
+ * How far a tour is over a lower bound
+ * @param cost is the length of the tour
+ * @param lower is the lower bound
+ * @return the gap as a percent of the bound, 0 if the bound isn't positive
+ */
+double Driver::gap(long long cost, long long lower) {
+    if(lower <= 0)
+        return 0;
+    return 100.0 * (cost - lower) / lower;
+}
+
 /**
  * Parses out an int from a line
  * @param line is in the format "[x]" where x is an int
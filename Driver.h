@@ -7,22 +7,45 @@
 
 #include <string>
 #include "Graph.h"
-#include "Set.h"
 #include "various.h"
 
 using namespace std;
 
 class Driver {
 public:
-    Driver() : gr(nullptr), type(UNSET), out(nullptr){}
+    Driver() : gr(nullptr), type(UNSET), warmStart(optimal), improve(i_none), out(nullptr){}
     void readFile(const string& fileName);
     void setType(const string& type);
+    void setImprove(const string& improve);
+    void setWarmStart(const string& type);
+    void setCooling(const string& tp);
+    void setBudget(uint32_t count, double seconds) {budgetCount = count; budgetSeconds = seconds;}
+    void setThreads(unsigned count) {threads = count;}
+    void setPopulation(uint32_t size) {population = size;}
+    void setPheromoneFile(const string& fileName) {pheromoneFile = fileName;}
+    void setCandidates(const string& tp);
+    void setCandidateFile(const string& fileName) {candidateFile = fileName;}
+    void setLowerBound(bool on) {lowerBound = on;}
+    void setGapTarget(double percent) {gapTarget = percent;}
     void setOutput(const string& fileName);
     void printVec(vector<string> vec);
 private:
     algo_Type type;
+    algo_Type warmStart;    // builds the tour the improvement engines start from
+    improve_Type improve;
     ofstream * out;
     Graph<string>* gr;
+    cool_Type cooling = c_geometric;
+    uint32_t budgetCount = 0;   // LK kicks, annealing moves, GA generations or ACO iterations, 0 picks a default
+    uint32_t population = 30;   // tours kept by the genetic algorithm
+    string pheromoneFile;       // ACO pheromone kept between runs, empty for none
+    bool alphaCandidates = false;   // alpha-nearness candidate lists instead of nearest neighbors
+    string candidateFile;       // alpha candidate lists kept between runs, empty for none
+    bool lowerBound = false;    // reports the Held-Karp bound and the gap to it
+    double gapTarget = 0;       // percent gap that stops improvement early, 0 never stops
+    double budgetSeconds = 0;   // 0 has no time limit
+    unsigned threads = 0;   // 0 uses every hardware thread
+    static double gap(long long cost, long long lower);
     static int parseInt(string str);
     static string trim(string str);
 };
@@ -0,0 +1,192 @@
+/**
+ * Exact solver for small graphs
+ * Held-Karp dynamic programming over subsets: the shortest path from the first node through
+ * exactly the nodes of a subset, ending at one of them, is the shortest path through the
+ * subset without that end plus one edge. Subsets of the other nodes are bitmasks, and the
+ * table keeps one 64 byte aligned row per subset with an entry per end. A subset only depends
+ * on subsets with one node less, so each layer of subsets with the same number of nodes is
+ * split across a thread pool, and the min over the previous end is one vectorized masked add
+ * and reduce over a row. It takes O(2^n n^2) time and 2^(n-1) rows, so it only fits graphs of
+ * a couple dozen nodes
+ */
+
+#ifndef TSP_EXACT_H
+#define TSP_EXACT_H
+
+#include <vector>
+#include <climits>
+#include <algorithm>
+#include "Graph.h"
+#include "DistMatrix.h"
+#include "ThreadPool.h"
+#include "Kernels.h"
+
+using namespace std;
+
+template <typename T>
+class Exact{
+public:
+    explicit Exact(Graph<T>& gr) : graph(gr) {}
+    vector<T> solve();
+    bool fits();
+    void setMemory(size_t bytes) {maxBytes = bytes;}
+    void setThreads(unsigned count) {threads = count;}
+    long long getCost() const {return cost;}
+    static size_t tableBytes(uint32_t n);
+private:
+    static const uint32_t MAX_NODES = 32;       // the other nodes have to fit in a 32 bit mask
+    static const int32_t FAR = INT32_MAX / 4;   // a missing edge or a path that can't exist
+    Graph<T>& graph;
+    size_t maxBytes = size_t(1) << 30;
+    unsigned threads = 0;       // 0 uses every hardware thread
+    long long cost = -1;
+    uint32_t stride = 0;        // entries per row
+    vector<int32_t> block;      // the allocation
+    int32_t* table = nullptr;   // first aligned entry in block
+    vector<int32_t> weights;    // weights[j * stride + k] is the weight between others k and j
+    int32_t* row(uint32_t mask) {return table + static_cast<size_t>(mask) * stride;}
+    static uint32_t unrank(uint64_t rank, uint32_t size, uint32_t count);
+};
+
+/**
+ * Bytes the table takes for a graph
+ * @tparam T is the type of the graph
+ * @param n is the number of nodes
+ * @return the size of the table in bytes
+ */
+template <typename T>
+size_t Exact<T>::tableBytes(uint32_t n) {
+    if(n < 2)
+        return 0;
+    const size_t perLine = DistMatrix::ALIGN / sizeof(int32_t);
+    size_t width = (n - 1 + perLine - 1) / perLine * perLine;
+    return (size_t(1) << (n - 1)) * width * sizeof(int32_t);
+}
+
+/**
+ * Checks if the graph is small enough, both for the memory budget and for every path length
+ * to fit in the 32 bit entries
+ * @tparam T is the type of the graph
+ * @return true if solve can run
+ */
+template <typename T>
+bool Exact<T>::fits() {
+    graph.buildIndex();
+    uint32_t n = graph.getNumNodes();
+    if(n < 3 || n > MAX_NODES || tableBytes(n) > maxBytes)
+        return false;
+    long long heaviest = 0;
+    for(uint32_t i = 0; i < n; i++)
+        for(uint32_t j = 0; j < n; j++)
+            heaviest = max<long long>(heaviest, graph.getWeight(i, j));
+    return heaviest * n < FAR;
+}
+
+/**
+ * Finds a shortest tour
+ * @tparam T is the type of the graph
+ * @return a closed tour starting and ending at the first node, empty if the graph doesn't fit
+ * or has no tour
+ */
+template <typename T>
+vector<T> Exact<T>::solve() {
+    cost = -1;
+    if(!fits())
+        return vector<T>();
+    uint32_t n = graph.getNumNodes(), others = n - 1;
+    const size_t perLine = DistMatrix::ALIGN / sizeof(int32_t);
+    stride = static_cast<uint32_t>((others + perLine - 1) / perLine * perLine);
+    // node 0 starts the tour, bit k of a mask is node k + 1
+    auto weight = [&](uint32_t from, uint32_t to) {
+        int w = graph.getWeight(from, to);
+        return w == -1 ? FAR : w;
+    };
+    weights.assign(static_cast<size_t>(others) * stride, 0);
+    for(uint32_t j = 0; j < others; j++)
+        for(uint32_t k = 0; k < others; k++)
+            weights[static_cast<size_t>(j) * stride + k] = weight(k + 1, j + 1);
+    size_t rows = size_t(1) << others;
+    block.assign(rows * stride + perLine, 0);
+    size_t skip = (DistMatrix::ALIGN - reinterpret_cast<uintptr_t>(block.data()) % DistMatrix::ALIGN) % DistMatrix::ALIGN;
+    table = block.data() + skip / sizeof(int32_t);
+    for(uint32_t j = 0; j < others; j++)
+        row(1u << j)[j] = weight(0, j + 1);
+    simd_Type level = simdLevel();
+    ThreadPool pool(threads);
+    uint64_t layer = others;    // subsets in the layer, others choose size
+    for(uint32_t size = 2; size <= others; size++){
+        layer = layer * (others - size + 1) / size;
+        pool.parallelFor(0, layer, [&](size_t lo, size_t hi, unsigned) {
+            uint32_t mask = unrank(lo, others, size);
+            for(size_t r = lo; r < hi; r++){
+                int32_t* out = row(mask);
+                for(uint32_t rest = mask; rest != 0; rest &= rest - 1){
+                    uint32_t j = static_cast<uint32_t>(__builtin_ctz(rest));
+                    uint32_t prev = mask & ~(1u << j);
+                    int32_t best = maskedMinSum(row(prev), weights.data() + static_cast<size_t>(j) * stride, prev, stride, level);
+                    out[j] = best < FAR ? best : FAR;
+                }
+                // next mask with the same number of bits, in increasing order
+                uint32_t low = mask & (0u - mask), ripple = mask + low;
+                mask = ripple | (((mask ^ ripple) >> 2) / low);
+            }
+        });
+    }
+    // closes the tour and walks the table back from the cheapest end
+    uint32_t full = (1u << others) - 1, end = NO_ID;
+    long long best = FAR;
+    for(uint32_t j = 0; j < others; j++){
+        long long total = static_cast<long long>(row(full)[j]) + weight(j + 1, 0);
+        if(total < best) {
+            best = total;
+            end = j;
+        }
+    }
+    if(end == NO_ID)
+        return vector<T>();
+    cost = best;
+    vector<T> path;
+    path.push_back(graph.getLabel(0));
+    for(uint32_t mask = full, at = end; at != NO_ID;){
+        path.push_back(graph.getLabel(at + 1));
+        uint32_t prev = mask & ~(1u << at), from = NO_ID;
+        for(uint32_t rest = prev; rest != 0 && from == NO_ID; rest &= rest - 1){
+            uint32_t k = static_cast<uint32_t>(__builtin_ctz(rest));
+            if(row(prev)[k] + weights[static_cast<size_t>(at) * stride + k] == row(mask)[at])
+                from = k;
+        }
+        mask = prev;
+        at = from;
+    }
+    path.push_back(graph.getLabel(0));
+    vector<int32_t>().swap(block);
+    table = nullptr;
+    return path;
+}
+
+/**
+ * Finds the subset at a rank among the subsets of the same size in increasing order, which is
+ * where a thread starts its part of a layer
+ * @tparam T is the type of the graph
+ * @param rank is the position of the subset in its layer
+ * @param size is the number of bits to pick from
+ * @param count is the number of bits set
+ * @return the mask of the subset
+ */
+template <typename T>
+uint32_t Exact<T>::unrank(uint64_t rank, uint32_t size, uint32_t count) {
+    uint32_t mask = 0;
+    for(uint32_t bit = size; bit-- > 0 && count > 0;){
+        uint64_t below = 1;     // subsets of count bits below this one, bit choose count
+        for(uint32_t i = 0; i < count; i++)
+            below = below * (bit - i) / (i + 1);
+        if(rank >= below) {
+            mask |= 1u << bit;
+            rank -= below;
+            count--;
+        }
+    }
+    return mask;
+}
+
+#endif //TSP_EXACT_H
@@ -0,0 +1,472 @@
+/**
+ * Genetic algorithm with edge assembly crossover (EAX)
+ * The population starts as nearest neighbor tours from spread out cities, plus any tours handed
+ * in, all improved with 2-opt and Or-opt. Every generation the population is shuffled into a
+ * ring and every tour is crossed with the next one. The edges the two parents don't share split
+ * into AB-cycles that alternate between the edges of each parent, and a child takes the first
+ * parent and swaps the edges of one AB-cycle for the second parent's, then joins the subtours
+ * that leaves with the cheapest 2-opt style exchanges between candidates. A child's cost comes
+ * from the edges that changed, so it never has to be summed. The best of a few children
+ * replaces the first parent if it is shorter. The crossovers of a generation only read the old
+ * population, so they run across the thread pool, and each one has its own random stream so
+ * the result doesn't depend on the thread count
+ */
+
+#ifndef TSP_GENETIC_H
+#define TSP_GENETIC_H
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "LocalSearch.h"
+#include "NN.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+template <typename T>
+class Genetic : public LocalSearch<T>{
+public:
+    explicit Genetic(Graph<T>& gr) : LocalSearch<T>(gr) {}
+    vector<T> optimize(const vector<vector<T>>& seeds);
+    void setLimits(uint32_t generations, uint32_t population, double seconds);
+    void setChildren(uint32_t count) {children = count;}
+    void setMutation(double rate) {mutation = rate;}
+    void setSeed(uint32_t value) {seed = value;}
+    uint32_t getGenerations() const {return generations;}
+protected:
+    struct individual{
+        vector<uint32_t> order;
+        long long cost;
+    };
+    // buffers for one crossover, kept per thread so they are only allocated once
+    struct workspace{
+        vector<uint32_t> linkA;     // the two tour neighbors of every city in each parent
+        vector<uint32_t> linkB;
+        vector<uint32_t> link;      // the child being built
+        vector<uint32_t> best;      // the best child so far
+        vector<uint32_t> open;      // edges of each parent not yet put in an AB-cycle, 2 slots each
+        vector<uint32_t> seen;      // position of a city on the walk, split by parity
+        vector<uint32_t> walk;
+        vector<uint32_t> comp;      // subtour of every city
+        vector<uint32_t> compSize;
+        vector<uint32_t> members;
+        vector<vector<uint32_t>> cycles;
+    };
+    uint32_t maxGenerations = 0;    // 0 runs until the population stops improving
+    uint32_t populationSize = 30;
+    double maxSeconds = 0;          // 0 has no time limit
+    uint32_t children = 10;         // children tried for every pair of parents
+    double mutation = 0.05;         // chance that the kept child gets a random 2-opt move
+    uint32_t seed = 1;
+    uint32_t generations = 0;
+    vector<individual> population;
+    void seedPopulation(const vector<vector<T>>& seeds, ThreadPool& pool);
+    void polish(LocalSearch<T>& search, individual& ind);
+    bool crossover(const individual& a, const individual& b, workspace& ws, mt19937& rng,
+                   LocalSearch<T>& search, individual& child);
+    void toLinks(const vector<uint32_t>& order, vector<uint32_t>& link) const;
+    void findCycles(workspace& ws, mt19937& rng) const;
+    long long applyCycle(workspace& ws, const vector<uint32_t>& cycle) const;
+    long long joinSubtours(workspace& ws) const;
+    static void relink(vector<uint32_t>& link, uint32_t city, uint32_t from, uint32_t to);
+};
+
+/**
+ * Sets when the search stops
+ * @tparam T is the type of the graph
+ * @param generations is the most generations to run, 0 runs until the population stops improving
+ * @param population is the number of tours kept, at least 2
+ * @param seconds is the time limit checked between generations, 0 has no time limit
+ */
+template <typename T>
+void Genetic<T>::setLimits(uint32_t generations, uint32_t population, double seconds) {
+    maxGenerations = generations;
+    populationSize = max<uint32_t>(2, population);
+    maxSeconds = seconds;
+}
+
+/**
+ * Evolves the population until a limit is reached or no child has replaced a parent for a few
+ * generations
+ * @tparam T is the type of the graph
+ * @param seeds are closed tours to put in the population first, like the one returned by getPath
+ * @return the best tour found, or the first seed if the graph is too small
+ */
+template <typename T>
+vector<T> Genetic<T>::optimize(const vector<vector<T>>& seeds) {
+    static const uint32_t STALL = 10;    // generations without a replacement before giving up
+    generations = 0;
+    vector<uint32_t> order;
+    if(seeds.empty() || !this->toIds(seeds[0], order) || order.size() < 8)
+        return seeds.empty() ? vector<T>() : seeds[0];
+    auto start = chrono::steady_clock::now();
+    ThreadPool pool(this->threads);
+    seedPopulation(seeds, pool);
+    uint32_t size = static_cast<uint32_t>(population.size());
+    vector<workspace> spaces(pool.getSize());
+    uint32_t stall = 0;
+    while(stall < STALL && (maxGenerations == 0 || generations < maxGenerations)){
+        if(maxSeconds > 0 && chrono::duration<double>(chrono::steady_clock::now() - start).count() >= maxSeconds)
+            break;
+        mt19937 shuffler(seed + generations);
+        vector<uint32_t> ring(size);
+        for(uint32_t i = 0; i < size; i++)
+            ring[i] = i;
+        shuffle(ring.begin(), ring.end(), shuffler);
+        vector<individual> kids(size);
+        vector<char> better(size, 0);
+        pool.parallelFor(0, size, [&](size_t lo, size_t hi, unsigned chunk) {
+            LocalSearch<T> search(this->graph);
+            search.setCandidates(this->cand);
+            for(size_t i = lo; i < hi; i++){
+                // every crossover gets its own stream, so the split into chunks doesn't matter
+                seed_seq mix{seed, generations, static_cast<uint32_t>(i)};
+                mt19937 rng(mix);
+                const individual& a = population[ring[i]];
+                const individual& b = population[ring[(i + 1) % size]];
+                better[i] = crossover(a, b, spaces[chunk], rng, search, kids[i]) && kids[i].cost < a.cost;
+            }
+        });
+        generations++;
+        bool replaced = false;
+        for(uint32_t i = 0; i < size; i++){
+            if(better[i]) {
+                population[ring[i]] = move(kids[i]);
+                replaced = true;
+            }
+        }
+        stall = replaced ? 0 : stall + 1;
+    }
+    uint32_t best = 0;
+    for(uint32_t i = 1; i < size; i++){
+        if(population[i].cost < population[best].cost)
+            best = i;
+    }
+    return this->toPath(population[best].order);
+}
+
+/**
+ * Fills the population with the seeds and nearest neighbor tours from evenly spaced cities,
+ * improving all of them with 2-opt and Or-opt across the thread pool
+ * @tparam T is the type of the graph
+ * @param seeds are closed tours to put in first
+ * @param pool runs the tours
+ */
+template <typename T>
+void Genetic<T>::seedPopulation(const vector<vector<T>>& seeds, ThreadPool& pool) {
+    uint32_t n = this->graph.getNumNodes();
+    population.assign(populationSize, individual());
+    vector<char> valid(populationSize, 0);
+    for(uint32_t i = 0; i < seeds.size() && i < populationSize; i++)
+        this->toIds(seeds[i], population[i].order);
+    pool.parallelFor(0, populationSize, [&](size_t lo, size_t hi, unsigned) {
+        LocalSearch<T> search(this->graph);
+        search.setCandidates(this->cand);
+        for(size_t i = lo; i < hi; i++){
+            individual& ind = population[i];
+            if(i >= seeds.size())
+                ind.order = NN<T>::tourFrom(this->graph, static_cast<uint32_t>(i * n / populationSize));
+            if(ind.order.size() != n)
+                continue;
+            polish(search, ind);
+            valid[i] = ind.order.size() == n;
+        }
+    });
+    // a seed or a stuck tour that doesn't visit every city is replaced by the first good tour
+    for(uint32_t i = 0; i < populationSize; i++){
+        if(!valid[i])
+            population[i] = population[find(valid.begin(), valid.end(), 1) - valid.begin()];
+    }
+}
+
+/**
+ * Improves a tour with 2-opt and Or-opt and works out its cost
+ * @tparam T is the type of the graph
+ * @param search is the calling thread's local search
+ * @param ind is the tour to improve
+ */
+template <typename T>
+void Genetic<T>::polish(LocalSearch<T>& search, individual& ind) {
+    vector<T> path = this->toPath(ind.order);
+    path = search.improve(path);
+    ind.order.clear();
+    for(size_t i = 0; i + 1 < path.size(); i++)
+        ind.order.push_back(this->graph.getId(path[i]));
+    ind.cost = 0;
+    for(size_t i = 0; i < ind.order.size(); i++)
+        ind.cost += this->dist(ind.order[i], ind.order[(i + 1) % ind.order.size()]);
+}
+
+/**
+ * Makes a few children of two parents and keeps the best
+ * @tparam T is the type of the graph
+ * @param a is the parent the children are built from
+ * @param b is the parent whose edges are brought in
+ * @param ws is the calling thread's buffers
+ * @param rng picks the AB-cycles
+ * @param search is the calling thread's local search, used for the mutation
+ * @param child is set to the best child
+ * @return false if the parents have the same edges, so there is no child
+ */
+template <typename T>
+bool Genetic<T>::crossover(const individual& a, const individual& b, workspace& ws, mt19937& rng,
+                           LocalSearch<T>& search, individual& child) {
+    toLinks(a.order, ws.linkA);
+    toLinks(b.order, ws.linkB);
+    findCycles(ws, rng);
+    if(ws.cycles.empty())
+        return false;
+    shuffle(ws.cycles.begin(), ws.cycles.end(), rng);
+    long long bestCost = LLONG_MAX;
+    for(uint32_t i = 0; i < ws.cycles.size() && i < children; i++){
+        ws.link = ws.linkA;
+        long long cost = a.cost + applyCycle(ws, ws.cycles[i]) + joinSubtours(ws);
+        if(cost < bestCost) {
+            bestCost = cost;
+            ws.best = ws.link;
+        }
+    }
+    // walks the links of the best child into a tour
+    uint32_t n = static_cast<uint32_t>(a.order.size());
+    child.order.assign(1, 0);
+    uint32_t prev = 0, cur = ws.best[0];
+    while(cur != 0){
+        child.order.push_back(cur);
+        uint32_t next = ws.best[2 * cur] == prev ? ws.best[2 * cur + 1] : ws.best[2 * cur];
+        prev = cur;
+        cur = next;
+    }
+    child.cost = bestCost;
+    if(uniform_real_distribution<double>(0.0, 1.0)(rng) < mutation) {
+        // a random 2-opt move, then 2-opt and Or-opt take the child to the nearest local optimum
+        uint32_t i = rng() % n, j = rng() % n;
+        reverse(child.order.begin() + min(i, j), child.order.begin() + max(i, j) + 1);
+        polish(search, child);
+    }
+    return child.order.size() == n;
+}
+
+/**
+ * Turns a tour into the two neighbors of every city
+ * @tparam T is the type of the graph
+ * @param order is the tour
+ * @param link is set to 2 slots per city
+ */
+template <typename T>
+void Genetic<T>::toLinks(const vector<uint32_t>& order, vector<uint32_t>& link) const {
+    uint32_t n = static_cast<uint32_t>(order.size());
+    link.resize(2 * static_cast<size_t>(n));
+    for(uint32_t i = 0; i < n; i++){
+        link[2 * order[i]] = order[i == 0 ? n - 1 : i - 1];
+        link[2 * order[i] + 1] = order[i + 1 == n ? 0 : i + 1];
+    }
+}
+
+/**
+ * Splits the edges that only one parent has into AB-cycles. A walk from a random city takes an
+ * unused edge of A, then one of B, and so on, and whenever it comes back to a city it left with
+ * the kind of edge it would take next, the loop in between is cut off as an AB-cycle. Every city
+ * has as many of these edges from A as from B, so the walk can always go on
+ * @tparam T is the type of the graph
+ * @param ws is the calling thread's buffers, cycles gets the AB-cycles, each one starting
+ * with an edge of A
+ * @param rng picks the cities and edges
+ */
+template <typename T>
+void Genetic<T>::findCycles(workspace& ws, mt19937& rng) const {
+    uint32_t n = static_cast<uint32_t>(ws.linkA.size() / 2);
+    ws.cycles.clear();
+    // slots 0 and 1 hold A's edges that B doesn't have, slots 2 and 3 B's edges that A doesn't
+    ws.open.assign(4 * static_cast<size_t>(n), NO_ID);
+    vector<uint32_t> left;
+    for(uint32_t v = 0; v < n; v++){
+        for(int s = 0; s < 2; s++){
+            uint32_t x = ws.linkA[2 * v + s], y = ws.linkB[2 * v + s];
+            if(x != ws.linkB[2 * v] && x != ws.linkB[2 * v + 1])
+                ws.open[4 * v + s] = x;
+            if(y != ws.linkA[2 * v] && y != ws.linkA[2 * v + 1])
+                ws.open[4 * v + 2 + s] = y;
+        }
+        if(ws.open[4 * v] != NO_ID || ws.open[4 * v + 1] != NO_ID)
+            left.push_back(v);
+    }
+    shuffle(left.begin(), left.end(), rng);
+    ws.seen.assign(2 * static_cast<size_t>(n), NO_ID);
+    for(uint32_t s = 0; s < left.size(); s++){
+        uint32_t v = left[s];
+        if(ws.open[4 * v] == NO_ID && ws.open[4 * v + 1] == NO_ID)
+            continue;
+        ws.walk.assign(1, v);
+        ws.seen[2 * v] = 0;
+        while(!ws.walk.empty()){
+            uint32_t pos = static_cast<uint32_t>(ws.walk.size() - 1);
+            uint32_t cur = ws.walk[pos];
+            uint32_t kind = pos % 2 == 0 ? 0 : 2;   // A's edges leave even positions
+            uint32_t* slot = &ws.open[4 * static_cast<size_t>(cur) + kind];
+            if(slot[0] == NO_ID && slot[1] == NO_ID) {   // only the start can run out
+                for(uint32_t i = 0; i < ws.walk.size(); i++)
+                    ws.seen[2 * ws.walk[i] + i % 2] = NO_ID;
+                ws.walk.clear();
+                break;
+            }
+            int pick = slot[0] == NO_ID ? 1 : slot[1] == NO_ID ? 0 : static_cast<int>(rng() % 2);
+            uint32_t next = slot[pick];
+            slot[pick] = NO_ID;
+            uint32_t* back = &ws.open[4 * static_cast<size_t>(next) + kind];
+            back[back[0] == cur ? 0 : 1] = NO_ID;
+            uint32_t at = pos + 1, parity = at % 2;
+            uint32_t earlier = ws.seen[2 * next + parity];
+            if(earlier == NO_ID) {
+                ws.seen[2 * next + parity] = at;
+                ws.walk.push_back(next);
+                continue;
+            }
+            // the walk closed a loop that alternates, starting and ending at next
+            vector<uint32_t> cycle(ws.walk.begin() + earlier, ws.walk.end());
+            for(uint32_t i = earlier + 1; i < ws.walk.size(); i++)
+                ws.seen[2 * ws.walk[i] + i % 2] = NO_ID;
+            ws.walk.resize(earlier + 1);
+            if(earlier % 2 == 1)    // the loop starts with an edge of B
+                rotate(cycle.begin(), cycle.begin() + 1, cycle.end());
+            ws.cycles.push_back(cycle);
+            if(earlier == 0) {
+                uint32_t* rest = &ws.open[4 * static_cast<size_t>(next)];
+                if(rest[0] == NO_ID && rest[1] == NO_ID) {
+                    ws.seen[2 * next] = NO_ID;
+                    ws.walk.clear();
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Swaps the edges of A in an AB-cycle for the edges of B in the child's links
+ * @tparam T is the type of the graph
+ * @param ws is the calling thread's buffers, link holds the child
+ * @param cycle is the cities of the AB-cycle, the edge from each even position is A's
+ * @return how much longer the child is than A, before the subtours are joined
+ */
+template <typename T>
+long long Genetic<T>::applyCycle(workspace& ws, const vector<uint32_t>& cycle) const {
+    long long delta = 0;
+    size_t len = cycle.size();
+    for(size_t i = 0; i < len; i += 2){
+        uint32_t x = cycle[i], y = cycle[(i + 1) % len];
+        relink(ws.link, x, y, NO_ID);
+        relink(ws.link, y, x, NO_ID);
+        delta -= this->dist(x, y);
+    }
+    for(size_t i = 1; i < len; i += 2){
+        uint32_t x = cycle[i], y = cycle[(i + 1) % len];
+        relink(ws.link, x, NO_ID, y);
+        relink(ws.link, y, NO_ID, x);
+        delta += this->dist(x, y);
+    }
+    return delta;
+}
+
+/**
+ * Joins the subtours of the child into one tour. The smallest subtour is joined to another one
+ * by removing an edge of each and reconnecting the four ends, picking the cheapest exchange
+ * between a city of the subtour and one of its candidates. If no candidate is outside the
+ * subtour every city outside it is tried
+ * @tparam T is the type of the graph
+ * @param ws is the calling thread's buffers, link holds the child
+ * @return how much longer the joins made the child
+ */
+template <typename T>
+long long Genetic<T>::joinSubtours(workspace& ws) const {
+    uint32_t n = static_cast<uint32_t>(ws.link.size() / 2);
+    ws.comp.assign(n, NO_ID);
+    ws.compSize.clear();
+    vector<uint32_t> heads;
+    for(uint32_t v = 0; v < n; v++){
+        if(ws.comp[v] != NO_ID)
+            continue;
+        uint32_t id = static_cast<uint32_t>(ws.compSize.size()), size = 0;
+        uint32_t prev = ws.link[2 * v], cur = v;
+        do{
+            ws.comp[cur] = id;
+            size++;
+            uint32_t next = ws.link[2 * cur] == prev ? ws.link[2 * cur + 1] : ws.link[2 * cur];
+            prev = cur;
+            cur = next;
+        } while(cur != v);
+        ws.compSize.push_back(size);
+        heads.push_back(v);
+    }
+    long long delta = 0;
+    for(uint32_t left = static_cast<uint32_t>(heads.size()); left > 1; left--){
+        uint32_t small = NO_ID;
+        for(uint32_t c = 0; c < heads.size(); c++){
+            if(ws.compSize[c] > 0 && (small == NO_ID || ws.compSize[c] < ws.compSize[small]))
+                small = c;
+        }
+        ws.members.clear();
+        uint32_t prev = ws.link[2 * heads[small]], cur = heads[small];
+        do{
+            ws.members.push_back(cur);
+            uint32_t next = ws.link[2 * cur] == prev ? ws.link[2 * cur + 1] : ws.link[2 * cur];
+            prev = cur;
+            cur = next;
+        } while(cur != heads[small]);
+        long long best = LLONG_MAX;
+        uint32_t bu = 0, bu2 = 0, bv = 0, bv2 = 0;
+        for(int pass = 0; pass < 2 && best == LLONG_MAX; pass++){
+            for(uint32_t m = 0; m < ws.members.size(); m++){
+                uint32_t u = ws.members[m];
+                uint32_t count = pass == 0 ? this->cand.count(u) : n;
+                for(uint32_t i = 0; i < count; i++){
+                    uint32_t v = pass == 0 ? this->cand.get(u)[i] : i;
+                    if(ws.comp[v] == small)
+                        continue;
+                    for(int su = 0; su < 2; su++){
+                        uint32_t u2 = ws.link[2 * u + su];
+                        for(int sv = 0; sv < 2; sv++){
+                            uint32_t v2 = ws.link[2 * v + sv];
+                            // (u, u2) and (v, v2) go, (u, v) and (u2, v2) come in
+                            long long change = this->dist(u, v) + this->dist(u2, v2)
+                                               - this->dist(u, u2) - this->dist(v, v2);
+                            if(change < best) {
+                                best = change;
+                                bu = u;
+                                bu2 = u2;
+                                bv = v;
+                                bv2 = v2;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        relink(ws.link, bu, bu2, bv);
+        relink(ws.link, bu2, bu, bv2);
+        relink(ws.link, bv, bv2, bu);
+        relink(ws.link, bv2, bv, bu2);
+        delta += best;
+        uint32_t into = ws.comp[bv];
+        for(uint32_t m = 0; m < ws.members.size(); m++)
+            ws.comp[ws.members[m]] = into;
+        ws.compSize[into] += ws.compSize[small];
+        ws.compSize[small] = 0;
+    }
+    return delta;
+}
+
+/**
+ * Replaces one neighbor of a city in a set of links
+ * @tparam T is the type of the graph
+ * @param link is 2 slots per city
+ * @param city is the city to change
+ * @param from is the neighbor to replace, NO_ID for an empty slot
+ * @param to is the new neighbor, NO_ID to empty the slot
+ */
+template <typename T>
+void Genetic<T>::relink(vector<uint32_t>& link, uint32_t city, uint32_t from, uint32_t to) {
+    link[2 * city + (link[2 * city] == from ? 0 : 1)] = to;
+}
+
+#endif //TSP_GENETIC_H
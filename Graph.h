@@ -9,51 +9,88 @@
 
 #include <cstdlib>
 #include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cstdint>
 #include <vector>
 #include <iostream>
 #include <queue>
 #include <stack>
 #include <climits>
 #include "various.h"
-#include "Set.h"
-#include "Set.h"
+#include "DisjointSet.h"
+#include "DistMatrix.h"
+#include "IndexedHeap.h"
+#include "ThreadPool.h"
+#include "Closure.h"
 
 using namespace std;
 
 template <typename T>
 class Graph {
 protected:
-    int numEdges = 0;
-    class Node{ // holds the data and the adjacent nodes
-    public:
-        T obj;
-        vector<T> edges;
-        bool visited;
-        int val;
-        double input;
-        int level;
-        int community;
-    };
-    struct Dijsktra{ // contains the node with the current distance and previous node
-    public:
-        Node nd;
-        int dist;
-        Node prev;
-        bool hasPrev;
-    };
-    unordered_map<T, Node> nodes;
-    int findSmallest(vector<Dijsktra>& vec);
-    int findNode(vector<Dijsktra>& vec, T search);
+    uint64_t numEdges = 0;
+    // every node is interned to a dense id the first time it is added
+    vector<T> labels;
+    unordered_map<T, uint32_t> ids;
+    // every edge by id in insertion order, unweighted edges have a weight of 0. Only kept
+    // while the graph is sparse, a dense graph's edges are read off the matrix
+    vector<idEdge> edgeList;
+    // compressed sparse row adjacency built from the edges, the neighbors of node i are
+    // adjacency[offsets[i]] to adjacency[offsets[i+1] - 1]
+    vector<uint32_t> offsets;
+    vector<uint32_t> adjacency;
+    vector<int> adjWeights;
+    vector<uint32_t> adjEdges;
+    bool adjValid = false;
+    // weight of the lightest edge between every connected pair, keyed by pairKey
+    unordered_map<uint64_t, int> edgeIndex;
+    // once the graph is dense the weights move out of edgeList and edgeIndex into a flat matrix
+    DistMatrix matrix;
+    bool dense = false;
+    bool indexValid = false;    // buildIndex has run since the graph last changed
+    storage_Type storage = s_auto;
+    matrix_Type matrixType = m_int32;
+    void indexEdges();
+    void makeDense();
+    void freeAdjacency();
+    mst_Type mstType = mst_auto;
+    mst_Type pickMinSpan() const;
+    vector<idEdge> kruskal();
+    vector<idEdge> primDense();
+    vector<idEdge> primSparse();
+    vector<idEdge> boruvka();
+    vector<idEdge> filterKruskal();
+    void filterKruskal(vector<idEdge>& edges, size_t lo, size_t hi, DisjointSet& s, vector<idEdge>& tree, ThreadPool& pool);
+    // the last spanning tree, reused until the graph changes
+    vector<idEdge> spanCache;
+    bool spanValid = false;
+    unsigned threads = 0;   // 0 uses every hardware thread
+    MetricClosure closure;  // shortest paths behind the edges added by closeMetric
+    apsp_Type apspType = apsp_auto;
+    size_t closureMemory = size_t(1) << 30;    // most bytes closeMetric may take
+    template <typename W>
+    void relaxRow(uint32_t from, const W* row, const vector<char>& inTree, vector<idEdge>& best);
+    void relaxPrim(uint32_t from, uint32_t to, int weight, const vector<char>& inTree, vector<idEdge>& best);
+    void indexEdge(uint32_t from, uint32_t to, int weight);
+    // per node state used by the searches and community detection
+    vector<char> visited;
+    vector<int> nodeVal;
+    vector<int> level;
+    vector<double> input;
+    vector<int> community;
     vector<edge<T>> GNBFS(T source, vector<edge<T>>& toIgnore);
     vector<edge<T>> sumEdges(vector<edge<T>>& vec);
     vector<edge<T>> sumVecs(vector<edge<T>>& tot, vector<edge<T>> vec);
     vector<edge<T>> findLargest(vector<edge<T>>& vec);
     bool check(vector<edge<T>> temp, vector<edge<T>> toIgnore);
     vector<vector<T>> makeCommunities(vector<edge<T>> toIgnore);
-    vector<weightEdge<T>> weights;
     void printGraph();
+    void pushEdge(uint32_t from, uint32_t to, int weight);
+    static uint64_t pairKey(uint32_t one, uint32_t two);
 public:
     Graph()= default;
+    virtual ~Graph() = default;
     void addNode(T val);
     void addEdge(T from, T to);
     void unVisit();
@@ -65,7 +102,33 @@ public:
     void addEdge(T from, T to, int weight);
     virtual vector<T> getPath() = 0;
     vector<weightEdge<T>> getMinSpan();
+    vector<idEdge> getMinSpanIds();
+    void setMinSpanType(mst_Type tp) {mstType = tp; spanValid = false;}
+    void setThreads(unsigned count) {threads = count;}
     int calcWeights(vector<T> vec);
+    long long tourCost(const vector<uint32_t>& tour) const;
+    bool closeMetric();
+    bool isClosed() const {return !closure.isEmpty();}
+    void setClosureType(apsp_Type tp) {apspType = tp;}
+    void setClosureMemory(size_t bytes) {closureMemory = bytes;}
+    vector<T> expandPath(const vector<T>& path) const;
+    void buildAdjacency();
+    int getWeight(uint32_t from, uint32_t to) const;
+    void setStorage(storage_Type tp, matrix_Type elem = m_int32);
+    void buildIndex();
+    bool isComplete() const;
+    bool isDense() const {return dense;}
+    const DistMatrix& getMatrix() const {return matrix;}
+    uint32_t getNumNodes() const {return static_cast<uint32_t>(labels.size());}
+    uint32_t getId(const T& val) const;
+    const T& getLabel(uint32_t id) const {return labels[id];}
+    vector<idEdge> getEdges() const;
+    template <typename F>
+    void forEachEdge(F visit) const;
+    uint32_t getDegree(uint32_t id) {buildAdjacency(); return offsets[id + 1] - offsets[id];}
+    const uint32_t* getNeighbors(uint32_t id) {buildAdjacency(); return adjacency.data() + offsets[id];}
+    const int* getNeighborWeights(uint32_t id) {buildAdjacency(); return adjWeights.data() + offsets[id];}
+    const uint32_t* getNeighborEdges(uint32_t id) {buildAdjacency(); return adjEdges.data() + offsets[id];}
 };
 
 /**
@@ -74,9 +137,27 @@ public:
  */
 template <typename T>
 void Graph<T>::clear(){
-    nodes.clear();
+    labels.clear();
+    ids.clear();
+    edgeList.clear();
+    offsets.clear();
+    adjacency.clear();
+    adjWeights.clear();
+    adjEdges.clear();
+    adjValid = false;
+    spanValid = false;
+    spanCache.clear();
+    edgeIndex.clear();
+    matrix.clear();
+    dense = false;
+    indexValid = false;
+    visited.clear();
+    nodeVal.clear();
+    level.clear();
+    input.clear();
+    community.clear();
     numEdges = 0;
-    weights.clear();
+    closure.clear();
 }
 
 /**
@@ -86,19 +167,303 @@ void Graph<T>::clear(){
  */
 template <typename T>
 void Graph<T>::addNode(T val){
-    auto iter = nodes.find(val);
+    auto iter = ids.find(val);
     // if the node doesn't already exist
-    if(iter == nodes.end()) {
-        Node nd;
-        vector<T> vec;
-        nd.edges = vec;
-        nd.obj = val;
-        nd.visited = false;
-        nodes.insert(pair<T, Node>(val, nd));
+    if(iter == ids.end()) {
+        ids.insert(pair<T, uint32_t>(val, static_cast<uint32_t>(labels.size())));
+        labels.push_back(val);
+        visited.push_back(false);
+        nodeVal.push_back(0);
+        level.push_back(INT_MAX);
+        input.push_back(0);
+        community.push_back(-1);
+        adjValid = false;
+        spanValid = false;
+        indexValid = false;
+        if(dense)   // the new node starts out unconnected
+            matrix.grow(getNumNodes());
     } else
         ; //don't re-add
 }
 
+/**
+ * Finds the dense id of a node
+ * @tparam T is the type of the graph
+ * @param val is the data stored in the node
+ * @return the id of the node, NO_ID if it was never added
+ */
+template <typename T>
+uint32_t Graph<T>::getId(const T& val) const {
+    auto iter = ids.find(val);
+    if(iter == ids.end())
+        return NO_ID;
+    return iter->second;
+}
+
+/**
+ * Records an edge between two ids and indexes its weight, the adjacency is rebuilt the
+ * next time it is needed. A dense graph writes the weight straight into the matrix
+ * @tparam T is the type of the graph
+ * @param from is the source id
+ * @param to is the destination id
+ * @param weight is the weight of the edge
+ */
+template <typename T>
+void Graph<T>::pushEdge(uint32_t from, uint32_t to, int weight) {
+    numEdges++;
+    adjValid = false;
+    spanValid = false;
+    indexValid = false;
+    if(dense && matrix.fits(weight)) {
+        matrix.setMin(from, to, weight);
+        return;
+    }
+    if(dense)   // the weight can't be stored in the matrix
+        indexEdges();
+    idEdge ed;
+    ed.from = from;
+    ed.to = to;
+    ed.weight = weight;
+    edgeList.push_back(ed);
+    indexEdge(from, to, weight);
+}
+
+/**
+ * Adds an edge to the hash index, keeping the lightest of parallel edges
+ * @tparam T is the type of the graph
+ * @param from is the source id
+ * @param to is the destination id
+ * @param weight is the weight of the edge
+ */
+template <typename T>
+void Graph<T>::indexEdge(uint32_t from, uint32_t to, int weight) {
+    auto found = edgeIndex.insert(pair<uint64_t, int>(pairKey(from, to), weight));
+    if(!found.second && weight < found.first->second)
+        found.first->second = weight;
+}
+
+/**
+ * Packs an unordered pair of ids into a single key
+ * @tparam T is the type of the graph
+ * @return a key that is the same for (one, two) and (two, one)
+ */
+template <typename T>
+uint64_t Graph<T>::pairKey(uint32_t one, uint32_t two) {
+    if(one > two)
+        swap(one, two);
+    return (static_cast<uint64_t>(one) << 32) | two;
+}
+
+/**
+ * Looks up the weight of the edge between two nodes in constant time
+ * @tparam T is the type of the graph
+ * @param from is the id of one end of the edge
+ * @param to is the id of the other end of the edge
+ * @return the weight of the lightest edge between the two nodes, -1 if they are not connected
+ */
+template <typename T>
+int Graph<T>::getWeight(uint32_t from, uint32_t to) const {
+    if(dense)
+        return matrix.get(from, to);
+    auto iter = edgeIndex.find(pairKey(from, to));
+    if(iter == edgeIndex.end())
+        return -1;
+    return iter->second;
+}
+
+/**
+ * Chooses how edge weights are stored
+ * @tparam T is the type of the graph
+ * @param tp is s_sparse for the hash index, s_dense for a flat matrix, or s_auto to use the
+ * matrix once every pair of nodes is connected
+ * @param elem is the element type of the matrix
+ */
+template <typename T>
+void Graph<T>::setStorage(storage_Type tp, matrix_Type elem) {
+    storage = tp;
+    if(elem != matrixType && dense)     // the weights move back out before the new matrix
+        indexEdges();
+    matrixType = elem;
+    indexValid = false;
+    buildIndex();
+}
+
+/**
+ * Checks if every pair of distinct nodes is connected by a weighted edge
+ * @tparam T is the type of the graph
+ * @return true if the graph is complete
+ */
+template <typename T>
+bool Graph<T>::isComplete() const {
+    uint64_t n = getNumNodes();
+    if(dense) { // every row must be full apart from the diagonal
+        for(uint32_t i = 0; i < n; i++)
+            for(uint32_t j = i + 1; j < n; j++)
+                if(matrix.get(i, j) == -1)
+                    return false;
+        return true;
+    }
+    uint64_t pairs = 0;
+    for(auto iter = edgeIndex.begin(); iter != edgeIndex.end(); iter++)
+        if((iter->first >> 32) != (iter->first & UINT32_MAX))   //self loops don't count
+            pairs++;
+    return pairs == n * (n - 1) / 2;
+}
+
+/**
+ * Moves the weights into whichever index the storage type asks for, the dense matrix is
+ * only used if every weight fits in its element type. Does nothing if the graph hasn't
+ * changed since the last call
+ * @tparam T is the type of the graph
+ */
+template <typename T>
+void Graph<T>::buildIndex() {
+    if(indexValid)
+        return;
+    indexValid = true;
+    bool wantDense = storage == s_dense || (storage == s_auto && isComplete());
+    if(wantDense == dense)
+        return;
+    if(wantDense)
+        makeDense();
+    else
+        indexEdges();
+}
+
+/**
+ * Moves the weights from the hash index into the matrix and frees the edge list, the hash
+ * index and the adjacency, so a dense graph only keeps the matrix
+ * @tparam T is the type of the graph
+ */
+template <typename T>
+void Graph<T>::makeDense() {
+    matrix.resize(getNumNodes(), matrixType);
+    for(auto iter = edgeIndex.begin(); iter != edgeIndex.end(); iter++) {
+        if(!matrix.fits(iter->second)) {
+            cout << "Weights don't fit in the matrix type, keeping sparse storage" << endl;
+            matrix.clear();
+            return;
+        }
+    }
+    for(auto iter = edgeIndex.begin(); iter != edgeIndex.end(); iter++)
+        matrix.set(static_cast<uint32_t>(iter->first >> 32), static_cast<uint32_t>(iter->first & UINT32_MAX), iter->second);
+    unordered_map<uint64_t, int>().swap(edgeIndex);  // release the hash table
+    vector<idEdge>().swap(edgeList);
+    freeAdjacency();
+    dense = true;
+}
+
+/**
+ * Frees the compressed sparse row adjacency, it is built again the next time it is needed
+ * @tparam T is the type of the graph
+ */
+template <typename T>
+void Graph<T>::freeAdjacency() {
+    vector<uint32_t>().swap(offsets);
+    vector<uint32_t>().swap(adjacency);
+    vector<int>().swap(adjWeights);
+    vector<uint32_t>().swap(adjEdges);
+    adjValid = false;
+}
+
+/**
+ * Rebuilds the edge list and hash index and frees the matrix. A dense graph gets its edge
+ * list back from the matrix, with parallel edges already merged into the lightest
+ * @tparam T is the type of the graph
+ */
+template <typename T>
+void Graph<T>::indexEdges() {
+    if(dense) {
+        edgeList = getEdges();
+        dense = false;
+        adjValid = false;
+    }
+    matrix.clear();
+    edgeIndex.clear();
+    for(unsigned int i = 0; i < edgeList.size(); i++)
+        indexEdge(edgeList[i].from, edgeList[i].to, edgeList[i].weight);
+}
+
+/**
+ * Calls a function on every edge without copying them, the edge list of a sparse graph in
+ * insertion order or every connected pair of the matrix with the lower id first
+ * @tparam T is the type of the graph
+ * @tparam F is the type of the function, taking a const idEdge&
+ * @param visit is the function to call
+ */
+template <typename T>
+template <typename F>
+void Graph<T>::forEachEdge(F visit) const {
+    if(!dense) {
+        for(unsigned int i = 0; i < edgeList.size(); i++)
+            visit(edgeList[i]);
+        return;
+    }
+    uint32_t n = getNumNodes();
+    for(uint32_t i = 0; i < n; i++){
+        for(uint32_t j = i; j < n; j++){
+            int weight = matrix.get(i, j);
+            if(weight != -1)
+                visit(idEdge{i, j, weight});
+        }
+    }
+}
+
+/**
+ * Gets every edge by id, built from the matrix on demand once the graph is dense
+ * @tparam T is the type of the graph
+ * @return a vector of the edges
+ */
+template <typename T>
+vector<idEdge> Graph<T>::getEdges() const {
+    if(!dense)
+        return edgeList;
+    vector<idEdge> edges;
+    forEachEdge([&](const idEdge& e) {edges.push_back(e);});
+    return edges;
+}
+
+/**
+ * Builds the compressed sparse row adjacency out of the edge list if any edges were added
+ * since it was last built. Each node's neighbors keep the order the edges were added in.
+ * Dense graphs are read straight from the matrix, so this only runs for them if something
+ * asks for the neighbor lists
+ * @tparam T is the type of the graph
+ */
+template <typename T>
+void Graph<T>::buildAdjacency() {
+    if(adjValid)
+        return;
+    uint32_t n = getNumNodes();
+    vector<idEdge> matrixEdges;
+    if(dense)
+        matrixEdges = getEdges();
+    const vector<idEdge>& edges = dense ? matrixEdges : edgeList;
+    offsets.assign(n + 1, 0);
+    for(unsigned int i = 0; i < edges.size(); i++){ // count the degree of every node
+        offsets[edges[i].from + 1]++;
+        offsets[edges[i].to + 1]++;
+    }
+    for(uint32_t i = 0; i < n; i++)
+        offsets[i + 1] += offsets[i];
+    adjacency.resize(offsets[n]);
+    adjWeights.resize(offsets[n]);
+    adjEdges.resize(offsets[n]);
+    vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for(unsigned int i = 0; i < edges.size(); i++){ //undirected, so store both directions
+        const idEdge& ed = edges[i];
+        uint32_t pos = fill[ed.from]++;
+        adjacency[pos] = ed.to;
+        adjWeights[pos] = ed.weight;
+        adjEdges[pos] = i;
+        pos = fill[ed.to]++;
+        adjacency[pos] = ed.from;
+        adjWeights[pos] = ed.weight;
+        adjEdges[pos] = i;
+    }
+    adjValid = true;
+}
+
 /**
  * Connects two nodes
  * @tparam T is the type of the graph
@@ -107,24 +472,17 @@ void Graph<T>::addNode(T val){
  */
 template <typename  T>
 void Graph<T>::addEdge(T from, T to) {
-    auto iter = nodes.find(from);
-    if(iter == nodes.end()) {   //makes sure the node exists
+    uint32_t fromId = getId(from);
+    if(fromId == NO_ID) {   //makes sure the node exists
         cout << "Not Found" << endl;
         return;
     }
-    Node fromNode = iter->second;
-    iter = nodes.find(to);
-    if(iter == nodes.end()) {   //makes sure the node exists
+    uint32_t toId = getId(to);
+    if(toId == NO_ID) {   //makes sure the node exists
         cout << "Not Found" << endl;
         return;
     }
-    numEdges++;
-    Node toNode = iter->second;
-    fromNode.edges.push_back(to);
-    nodes[from] = fromNode;
-    toNode.edges.push_back(from);
-    nodes[to] = toNode;
-
+    pushEdge(fromId, toId, 0);
 }
 
 /**
@@ -135,33 +493,31 @@ void Graph<T>::addEdge(T from, T to) {
 template <typename T>
 vector<edge<T>> Graph<T>::BFS(T source) {
     unVisit();  //reset all nodes
+    buildAdjacency();
     vector<edge<T>> vec;
-    queue<T> que;
-    auto iter = nodes.find(source);
+    queue<uint32_t> que;
+    uint32_t src = getId(source);
     // make sure that the source exists
-    if(iter == nodes.end()){
+    if(src == NO_ID){
         cout << "Source not found" << endl;
         return vec;
     }
-    que.push(source);
+    que.push(src);
     // exhaustive search
     while(!que.empty()){
-        T orig_T = que.front();
-        Node origin = nodes[orig_T];
+        uint32_t origin = que.front();
         que.pop();
-        if(origin.visited) //ignore if duplicate
+        if(visited[origin]) //ignore if duplicate
             continue;
-        origin.visited = true;
-        nodes[orig_T] = origin; //reset obj in map
+        visited[origin] = true;
         // search through all connections
-        for(unsigned int i = 0; i < origin.edges.size(); i++) {
-            T dest = origin.edges[i];
-            Node dest_Node = nodes[dest];
-            if(!dest_Node.visited) {
+        for(uint32_t i = offsets[origin]; i < offsets[origin + 1]; i++) {
+            uint32_t dest = adjacency[i];
+            if(!visited[dest]) {
                 que.push(dest);
                 edge<T> ed;
-                ed.from = origin.obj;
-                ed.to = dest;
+                ed.from = labels[origin];
+                ed.to = labels[dest];
                 vec.push_back(ed);
             }
         }
@@ -178,31 +534,31 @@ vector<edge<T>> Graph<T>::BFS(T source) {
 template <typename T>
 vector<edge<T>> Graph<T>::DFS(T source) {
     unVisit();  //reset all nodes
+    buildAdjacency();
     vector<edge<T>> vec;
-    stack<T> stk;
-    auto iter = nodes.find(source);
+    stack<uint32_t> stk;
+    uint32_t src = getId(source);
     // make sure that the source exists
-    if(iter == nodes.end()){
+    if(src == NO_ID){
         cout << "Source not found" << endl;
         return vec;
     }
-    stk.push(source);
+    // the next neighbor to try for every node, so no connection is scanned twice
+    vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+    stk.push(src);
     // exhaustive search
     while(!stk.empty()){
-        T orig_T = stk.top();
-        Node origin = nodes[orig_T];
-        origin.visited = true;
-        nodes[orig_T] = origin; //reset obj in map
+        uint32_t origin = stk.top();
+        visited[origin] = true;
         bool isFound = false;
         // search until an available connection is found
-        for(unsigned int i = 0; i < origin.edges.size(); i++) {
-            T dest = origin.edges[i];
-            Node dest_Node = nodes[dest];
-            if(!dest_Node.visited) {
+        for(; cursor[origin] < offsets[origin + 1]; cursor[origin]++) {
+            uint32_t dest = adjacency[cursor[origin]];
+            if(!visited[dest]) {
                 stk.push(dest);
                 edge<T> ed;
-                ed.from = origin.obj;
-                ed.to = dest;
+                ed.from = labels[origin];
+                ed.to = labels[dest];
                 vec.push_back(ed);
                 isFound = true;
                 break;
@@ -220,129 +576,59 @@ vector<edge<T>> Graph<T>::DFS(T source) {
  */
 template <typename T>
 void Graph<T>::unVisit() {
-    for(auto iter = nodes.begin(); iter != nodes.end(); iter++) {
-        Node n = iter->second;
-        n.visited = false;
-        n.val = 0;
-        n.level = INT_MAX;
-        n.input = 0;
-        nodes[n.obj] = n;
-    }
+    fill(visited.begin(), visited.end(), false);
+    fill(nodeVal.begin(), nodeVal.end(), 0);
+    fill(level.begin(), level.end(), INT_MAX);
+    fill(input.begin(), input.end(), 0);
 }
 
 /**
- * Connects two nodes to each other based off of Dijkstra's algorithm
+ * Connects two nodes to each other with the fewest number of edges. Every edge has the
+ * same length, so Dijkstra's algorithm reduces to a breath first search
  * @param from is the start node
  * @param to is the end node
  * @return a vector of the nodes
  */
 template <typename T>
 vector<T> Graph<T>::connect(T from, T to) {
-    vector<Dijsktra> removed;
-    vector<Dijsktra> vec;
-    for(auto mapIter = nodes.begin(); mapIter != nodes.end(); mapIter++){ //puts all vertexes into a set
-        Dijsktra d;
-        d.nd = mapIter->second;
-        d.hasPrev = false; // sets all nodes to automatically have no previous node
-        if(d.nd.obj == from) {
-            d.dist = 0;
-        }     //if start, set distance to 0
-        else {
-            d.dist = INT_MAX;
-        }   //set distance to 'infinity'
-        vec.push_back(d);
-    }
-
+    vector<T> toReturn;
+    uint32_t src = getId(from);
+    uint32_t dst = getId(to);
+    if(src == NO_ID || dst == NO_ID)
+        return toReturn;
+    buildAdjacency();
+    vector<uint32_t> prev(getNumNodes(), NO_ID);
+    unVisit();
+    queue<uint32_t> que;
+    que.push(src);
+    visited[src] = true;
     bool isFound = false;
-    auto vecIter = vec.begin();
-    while(vec.size() != 0){ // as long as there are still nodes to look at
-        int index = findSmallest(vec);  // find the smallest current distance
-        if(index == -1)
-            break;
-        Dijsktra d = vec.at(index);
-        removed.push_back(d); // keep track of previously looked at nodes
-        vec.erase(vecIter + index);
-        if(d.nd.obj == to) { // if this is the end, break
+    while(!que.empty()){ // as long as there are still nodes to look at
+        uint32_t cur = que.front();
+        que.pop();
+        if(cur == dst) { // if this is the end, break
             isFound = true;
             break;
         }
-        vector<T> edges = d.nd.edges;
-        for(unsigned int j = 0; j < edges.size(); j++) { //look at all edges
-            int alt = d.dist + 1;
-            int pos = findNode(vec, edges.at(j));
-            if (pos != -1) { //if the node hasn't already been looked at
-                Dijsktra other = vec.at(pos);
-                if (alt < other.dist) { // if the distance between these two nodes is smaller than its current distance
-                    other.dist = alt;
-                    other.prev = d.nd;
-                    other.hasPrev = true;
-                    vec.at(pos) = other; //reset in vector
-                }
+        for(uint32_t j = offsets[cur]; j < offsets[cur + 1]; j++) { //look at all edges
+            uint32_t other = adjacency[j];
+            if (!visited[other]) {
+                visited[other] = true;
+                prev[other] = cur;
+                que.push(other);
             }
         }
     }
-    vector<T> toReturn;
     if(!isFound){
         return toReturn;
     }
-    //starting at the end, find each node's previous and add to the stack to create a path
-    stack<T> stk;
-    int num = findNode(removed, to);
-    Dijsktra reverse = removed.at(num);
-    stk.push(reverse.nd.obj); //adds start node
-    while(reverse.hasPrev){ //so it doesn't try to access a node that doesn't exist
-        Node pre = reverse.prev;
-        num = findNode(removed, pre.obj);
-        reverse = removed.at(num);
-        stk.push(reverse.nd.obj);
-    }
-
-    // reverses the stack by pushing the top into a vector
-    while(!stk.empty()){
-        toReturn.push_back(stk.top());
-        stk.pop();
-    }
+    //starting at the end, follow each node's previous node back to the start
+    for(uint32_t cur = dst; cur != NO_ID; cur = prev[cur])
+        toReturn.push_back(labels[cur]);
+    reverse(toReturn.begin(), toReturn.end());
     return toReturn;
 }
 
-/**
- * Helper method to find smallest current distance in a vector of Dijkstra nodes
- * @tparam T is the type of the graph
- * @param vec is a vector of nodes
- * @return the index of the smallest distance
- */
-template <typename T>
-int Graph<T>::findSmallest(vector<Graph<T>::Dijsktra>& vec) {
-    int smallest = INT_MAX;
-    int pos = -1;
-    for(unsigned int i = 0; i < vec.size(); i++){
-        Dijsktra d = vec.at(i);
-        if(d.dist < smallest){
-            smallest = d.dist;
-            pos = static_cast<int>(i);
-        }
-    }
-    return pos;
-}
-
-/**
- * Searches for the position of a given node based off of the object
- * @tparam T is the type of the graph
- * @param vec is a vector of Dijkstra nodes
- * @param search is the object to look for
- * @return the position
- */
-template <typename T>
-int Graph<T>::findNode(vector<Graph<T>::Dijsktra> &vec, T search) {
-    for(unsigned int i = 0; i < vec.size(); i++){
-        Dijsktra d = vec.at(i);
-        if(d.nd.obj == search)
-            return static_cast<int>(i);
-    }
-    return -1;
-}
-
-
 /**
  * Discovers communities using the girvan-newman algorithm
  * @tparam T is the type of the graph
@@ -350,7 +636,6 @@ int Graph<T>::findNode(vector<Graph<T>::Dijsktra> &vec, T search) {
  */
 template <typename T>
 vector<vector<T>> Graph<T>::discover() {
-    auto iter = nodes.begin();
     vector<edge<T>> toIgnore;
     bool totSet = false;
     bool ignoreSet = false;
@@ -361,8 +646,8 @@ vector<vector<T>> Graph<T>::discover() {
 //            cout << num << " " << toIgnore.size() << endl;
         totSet = false;
         vector<edge<T>> tot;
-        for (iter = nodes.begin(); iter != nodes.end(); iter++) { //Modified BFS every node
-            vector<edge<T>> vec = GNBFS(iter->first, toIgnore);
+        for (uint32_t i = 0; i < getNumNodes(); i++) { //Modified BFS every node
+            vector<edge<T>> vec = GNBFS(labels[i], toIgnore);
             vec = sumEdges(vec);
             if (!totSet) {
                 if(vec.size() > 0) {
@@ -399,53 +684,40 @@ vector<vector<T>> Graph<T>::discover() {
 template <typename T>
 vector<edge<T>> Graph<T>::GNBFS(T source, vector<edge<T>>& toIgnore) {
     unVisit();  //reset all nodes
+    buildAdjacency();
     vector<edge<T>> vec;
-    queue<T> que;
-    auto iter = nodes.find(source);
+    queue<uint32_t> que;
+    uint32_t src = getId(source);
     // make sure that the source exists
-    if(iter == nodes.end()){
+    if(src == NO_ID){
         cout << "Source not found" << endl;
         return vec;
     }
-    iter->second.val++;
-    iter->second.level = 0;
-    nodes[source] = iter->second;
-    que.push(source);
+    // undirected, so both orientations of an ignored edge share one key
+    unordered_set<uint64_t> ignored;
+    for(unsigned int j = 0; j < toIgnore.size(); j++)
+        ignored.insert(pairKey(getId(toIgnore[j].from), getId(toIgnore[j].to)));
+    nodeVal[src]++;
+    level[src] = 0;
+    que.push(src);
     // exhaustive search
     while(!que.empty()){
-        T orig_T = que.front();
-        Node origin = nodes[orig_T];
+        uint32_t origin = que.front();
         que.pop();
-        if(origin.visited) //ignore if duplicate
+        if(visited[origin]) //ignore if duplicate
             continue;
-        origin.visited = true;
-        nodes[orig_T] = origin; //reset obj in map
+        visited[origin] = true;
         // search through all connections
-        for(unsigned int i = 0; i < origin.edges.size(); i++) {
-            T dest = origin.edges[i];
-            Node dest_Node = nodes[dest];
-            if(!dest_Node.visited && origin.level < dest_Node.level) { //only add if on a lower level
-                bool willIgnore = false;
-                for(unsigned int j = 0; j < toIgnore.size(); j++){
-                    edge<T> ignoreEdge = toIgnore.at(j);
-                    if((orig_T == ignoreEdge.from)&&(dest == ignoreEdge.to)){
-                        willIgnore = true;
-                        break;
-                    }  //if undirected, check the other way around
-                    if((orig_T == ignoreEdge.to)&&(dest == ignoreEdge.from)){
-                        willIgnore = true;
-                        break;
-                    }
-
-                }
-                if(!willIgnore) {
-                    dest_Node.val += origin.val;
-                    dest_Node.level = origin.level + 1;
-                    nodes[dest] = dest_Node;
+        for(uint32_t i = offsets[origin]; i < offsets[origin + 1]; i++) {
+            uint32_t dest = adjacency[i];
+            if(!visited[dest] && level[origin] < level[dest]) { //only add if on a lower level
+                if(ignored.find(pairKey(origin, dest)) == ignored.end()) {
+                    nodeVal[dest] += nodeVal[origin];
+                    level[dest] = level[origin] + 1;
                     que.push(dest);
                     edge<T> ed;
-                    ed.from = origin.obj;
-                    ed.to = dest;
+                    ed.from = labels[origin];
+                    ed.to = labels[dest];
                     vec.push_back(ed);
                 }
             }
@@ -464,17 +736,16 @@ template <typename T>
 vector<edge<T>> Graph<T>::sumEdges(vector<edge<T>>& vec) {
     for(int i = vec.size() - 1; i >= 0; i--){
         edge<T> edg = vec.at(i);
-        Node toNode = nodes[edg.to];
-        Node fromNode = nodes[edg.from];
+        uint32_t toId = getId(edg.to);
+        uint32_t fromId = getId(edg.from);
         double base = 1;    //all nodes have a default value of 1
-        base  += toNode.input;  //add in weights of incoming edges
-        base *= fromNode.val;   //multiply by the value of the starting node
-        base /= toNode.val; //split the value amongst the parent nodes
+        base  += input[toId];  //add in weights of incoming edges
+        base *= nodeVal[fromId];   //multiply by the value of the starting node
+        base /= nodeVal[toId]; //split the value amongst the parent nodes
         base /= 2.0;
         edg.val = base; //assign the edge the value
         vec.at(i) = edg;
-        fromNode.input += base; //set the destination node's value
-        nodes[edg.from] = fromNode;
+        input[fromId] += base; //set the destination node's value
     }
     return vec;
 }
@@ -552,8 +823,10 @@ bool Graph<T>::check(vector<edge<T>> temp, vector<edge<T>> toIgnore) {
             edge<T> edg = temp.at(i);
             int connections = 0;
             T from = edg.from;
-            Node fromNode = nodes[from];
-            vec = fromNode.edges;
+            uint32_t fromId = getId(from);
+            vec.clear();
+            for(uint32_t j = 0; j < getDegree(fromId); j++)
+                vec.push_back(labels[getNeighbors(fromId)[j]]);
             for(unsigned int j = 0; j < vec.size(); j++){    //for every connection starting at the from node
                 T to_temp = vec.at(j);
                 bool isFound = false;
@@ -590,8 +863,10 @@ bool Graph<T>::check(vector<edge<T>> temp, vector<edge<T>> toIgnore) {
             //if graph is undirected, check in the opposite direction
             T to = edg.to;
             connections = 0;
-            Node toNode = nodes[to];
-            vec = toNode.edges;
+            uint32_t toId = getId(to);
+            vec.clear();
+            for(uint32_t j = 0; j < getDegree(toId); j++)
+                vec.push_back(labels[getNeighbors(toId)[j]]);
             for(unsigned int j = 0; j < vec.size(); j++){    //for every connection starting at the to node
                 T from_temp = vec.at(j);
                 bool isFound = false;
@@ -623,35 +898,27 @@ bool Graph<T>::check(vector<edge<T>> temp, vector<edge<T>> toIgnore) {
  */
 template <typename T>
 vector<vector<T>> Graph<T>::makeCommunities(vector<edge<T>> toIgnore){
-    auto iter = nodes.begin();
-    for(iter = nodes.begin(); iter != nodes.end(); iter++) //reset communities
-        iter->second.community = -1;
+    fill(community.begin(), community.end(), -1); //reset communities
     int num = 0;
-    for(iter = nodes.begin(); iter != nodes.end(); iter++){
-        Node nd = iter->second;
-        if(nd.community == -1){ //if already categorized, skip
-            nd.community = num;
-            vector<edge<T>> com = GNBFS(nd.obj, toIgnore);
+    for(uint32_t nd = 0; nd < getNumNodes(); nd++){
+        if(community[nd] == -1){ //if already categorized, skip
+            community[nd] = num;
+            vector<edge<T>> com = GNBFS(labels[nd], toIgnore);
             for(unsigned int i = 0; i < com.size(); i++){  // sets both sides to the same community
-                edge<T> edg = com.at(i);
-                Node fromNode = nodes[edg.from];
-                Node toNode = nodes[edg.to];
-                if(fromNode.community == -1)
-                    fromNode.community = num;
-                if(toNode.community == -1)
-                    toNode.community = num;
-                nodes[edg.from] = fromNode;
-                nodes[edg.to] = toNode;
+                uint32_t fromId = getId(com[i].from);
+                uint32_t toId = getId(com[i].to);
+                if(community[fromId] == -1)
+                    community[fromId] = num;
+                if(community[toId] == -1)
+                    community[toId] = num;
             }
             num++;
         }
-        nodes[nd.obj] = nd;
     }
     vector<vector<T>> toReturn;
     toReturn.resize(num);
-    for(iter = nodes.begin(); iter != nodes.end(); iter++){ //pushes them into vectors according to their community num
-        Node nd = iter->second;
-        toReturn.at(nd.community).push_back(nd.obj);
+    for(uint32_t nd = 0; nd < getNumNodes(); nd++){ //pushes them into vectors according to their community num
+        toReturn.at(community[nd]).push_back(labels[nd]);
     }
     return toReturn;
 }
@@ -665,69 +932,408 @@ vector<vector<T>> Graph<T>::makeCommunities(vector<edge<T>> toIgnore){
  */
 template <typename T>
 void Graph<T>::addEdge(T from, T to, int weight) {
-    auto iter = nodes.find(from);
-    if(iter == nodes.end()) {   //makes sure the node exists
+    uint32_t fromId = getId(from);
+    if(fromId == NO_ID) {   //makes sure the node exists
         cout << "Not Found" << endl;
         return;
     }
-    Node fromNode = iter->second;
-    iter = nodes.find(to);
-    if(iter == nodes.end()) {   //makes sure the node exists
+    uint32_t toId = getId(to);
+    if(toId == NO_ID) {   //makes sure the node exists
         cout << "Not Found" << endl;
         return;
     }
-    numEdges++;
-    Node toNode = iter->second;
-    fromNode.edges.push_back(to);
-    toNode.edges.push_back(from);
-    nodes[from] = fromNode;
-    nodes[to] = toNode;
-    weightEdge<T> wEd;
-    wEd.from = from;
-    wEd.to = to;
-    wEd.weight = weight;
-    weights.push_back(wEd);
+    pushEdge(fromId, toId, weight);
 }
 
 /**
- * Gets the minimum spanning tree for a graph based off of Kruskal's algorithm
+ * Gets the minimum spanning tree for a graph
  * @tparam T is the type of the graph
  * @return a vector of weighted edges that are used in the spanning tree
  */
 template <typename T>
 vector<weightEdge<T>> Graph<T>::getMinSpan() {
+    vector<idEdge> tree = getMinSpanIds();
     vector<weightEdge<T>> vec;
-    auto* s = new Set<T>();
-    sort(weights.begin(), weights.end(), customFunc<T>());
-    for(unsigned int i = 0; i < weights.size(); i++){
-        T from = weights[i].from;
-        T to = weights[i].to;
-        int index_from = s->find(from);
-        int index_to = s->find(to);
-        int weight = weights[i].weight;
-        if(index_from == -1 || index_to == -1 || (index_from != index_to)){
-            vec.push_back(weights[i]);
-            if(index_from == -1)
-                s->makeSet(from);
-            if(index_to == -1)
-                s->makeSet(to);
-            s->union_(from, to);
-        }
+    for(unsigned int i = 0; i < tree.size(); i++){
+        weightEdge<T> wE;
+        wE.from = labels[tree[i].from];
+        wE.to = labels[tree[i].to];
+        wE.weight = tree[i].weight;
+        vec.push_back(wE);
     }
     return vec;
 }
 
+/**
+ * Gets the minimum spanning tree (or forest if the graph isn't connected) by id. Every
+ * algorithm breaks ties with idEdgeOrder, so they all return the same set of edges, and the
+ * tree is kept until the graph changes so repeated solves don't rebuild it
+ * @tparam T is the type of the graph
+ * @return a vector of the edges in the tree
+ */
+template <typename T>
+vector<idEdge> Graph<T>::getMinSpanIds() {
+    buildIndex();
+    if(spanValid)
+        return spanCache;
+    mst_Type tp = mstType;
+    if(tp == mst_auto)
+        tp = pickMinSpan();
+    if(tp == mst_prim)
+        spanCache = primDense();
+    else if(tp == mst_primHeap)
+        spanCache = primSparse();
+    else if(tp == mst_boruvka)
+        spanCache = boruvka();
+    else if(tp == mst_filterKruskal)
+        spanCache = filterKruskal();
+    else
+        spanCache = kruskal();
+    spanValid = true;
+    return spanCache;
+}
+
+/**
+ * Picks the spanning tree algorithm that suits the density of the graph. Array based Prim
+ * never looks at an edge twice, so it wins once a good share of all pairs are connected,
+ * heap based Prim avoids sorting every edge on medium graphs, and Kruskal is the cheapest
+ * on sparse graphs. Large sparse graphs use parallel Boruvka when there are spare threads
+ * @tparam T is the type of the graph
+ * @return the algorithm to use
+ */
+template <typename T>
+mst_Type Graph<T>::pickMinSpan() const {
+    uint64_t n = getNumNodes();
+    uint64_t m = edgeList.size();
+    if(dense || 4 * m >= n * (n - 1))
+        return mst_prim;
+    unsigned count = threads == 0 ? ThreadPool::defaultSize() : threads;
+    if(count > 1 && m >= 100000)
+        return mst_boruvka;
+    if(m >= 8 * n)
+        return mst_primHeap;
+    return mst_kruskal;
+}
+
+/**
+ * Kruskal's algorithm, joins trees with the lightest edges first
+ * @tparam T is the type of the graph
+ * @return a vector of the edges in the tree
+ */
+template <typename T>
+vector<idEdge> Graph<T>::kruskal() {
+    vector<idEdge> tree;
+    DisjointSet s(getNumNodes());
+    vector<idEdge> sorted = getEdges();
+    sort(sorted.begin(), sorted.end(), idEdgeOrder());
+    for(unsigned int i = 0; i < sorted.size() && s.getCount() > 1; i++){
+        if(s.union_(sorted[i].from, sorted[i].to)) // only keep edges joining two trees
+            tree.push_back(sorted[i]);
+    }
+    return tree;
+}
+
+/**
+ * Filter-Kruskal, splits the edges around a pivot and builds the tree from the light half
+ * first, then throws away heavy edges whose ends are already joined before they are ever
+ * sorted. Large partitions and filters are split across the thread pool
+ * @tparam T is the type of the graph
+ * @return a vector of the edges in the tree
+ */
+template <typename T>
+vector<idEdge> Graph<T>::filterKruskal() {
+    vector<idEdge> tree;
+    DisjointSet s(getNumNodes());
+    vector<idEdge> edges = getEdges();
+    ThreadPool pool(threads);
+    filterKruskal(edges, 0, edges.size(), s, tree, pool);
+    return tree;
+}
+
+/**
+ * Adds the tree edges among edges[lo, hi) in idEdgeOrder
+ * @tparam T is the type of the graph
+ * @param edges is the scratch copy of the edges, reordered in place
+ * @param lo is the first edge of the range
+ * @param hi is one past the last edge of the range
+ * @param s joins the nodes already in the tree
+ * @param tree is the tree so far
+ * @param pool runs the partition and filter steps
+ */
+template <typename T>
+void Graph<T>::filterKruskal(vector<idEdge>& edges, size_t lo, size_t hi, DisjointSet& s, vector<idEdge>& tree, ThreadPool& pool) {
+    const size_t BASE = 4096;       // ranges this small are just sorted
+    const size_t PARALLEL = 65536;  // ranges this large are split across the pool
+    idEdgeOrder order;
+    if(s.getCount() <= 1 || lo >= hi)
+        return;
+    size_t mid = hi;
+    if(hi - lo > BASE){
+        // median of nine spread out edges
+        vector<idEdge> sample;
+        for(size_t i = 0; i < 9; i++)
+            sample.push_back(edges[lo + (hi - lo - 1) * i / 8]);
+        nth_element(sample.begin(), sample.begin() + 4, sample.end(), order);
+        idEdge pivot = sample[4];
+        auto light = [&](const idEdge& ed) {return !order(pivot, ed);};
+        if(hi - lo < PARALLEL || pool.getSize() == 1)
+            mid = stable_partition(edges.begin() + lo, edges.begin() + hi, light) - edges.begin();
+        else {
+            vector<vector<idEdge>> lights(pool.getSize());
+            vector<vector<idEdge>> heavies(pool.getSize());
+            pool.parallelFor(lo, hi, [&](size_t b, size_t e, unsigned c) {
+                for(size_t i = b; i < e; i++)
+                    (light(edges[i]) ? lights[c] : heavies[c]).push_back(edges[i]);
+            });
+            size_t pos = lo;
+            for(unsigned int c = 0; c < lights.size(); c++)
+                for(unsigned int i = 0; i < lights[c].size(); i++)
+                    edges[pos++] = lights[c][i];
+            mid = pos;
+            for(unsigned int c = 0; c < heavies.size(); c++)
+                for(unsigned int i = 0; i < heavies[c].size(); i++)
+                    edges[pos++] = heavies[c][i];
+        }
+    }
+    if(mid == hi){ // small enough, or the pivot couldn't split the range, so sort it
+        sort(edges.begin() + lo, edges.begin() + hi, order);
+        for(size_t i = lo; i < hi && s.getCount() > 1; i++)
+            if(s.union_(edges[i].from, edges[i].to))
+                tree.push_back(edges[i]);
+        return;
+    }
+    filterKruskal(edges, lo, mid, s, tree, pool);
+    // drop the heavy edges that would close a cycle, nothing is merged while this runs
+    size_t end = mid;
+    if(hi - mid < PARALLEL || pool.getSize() == 1){
+        for(size_t i = mid; i < hi; i++)
+            if(s.find(edges[i].from) != s.find(edges[i].to))
+                edges[end++] = edges[i];
+    }
+    else {
+        vector<vector<idEdge>> kept(pool.getSize());
+        pool.parallelFor(mid, hi, [&](size_t b, size_t e, unsigned c) {
+            for(size_t i = b; i < e; i++)
+                if(s.findRoot(edges[i].from) != s.findRoot(edges[i].to))
+                    kept[c].push_back(edges[i]);
+        });
+        for(unsigned int c = 0; c < kept.size(); c++)
+            for(unsigned int i = 0; i < kept[c].size(); i++)
+                edges[end++] = kept[c][i];
+    }
+    filterKruskal(edges, mid, end, s, tree, pool);
+}
+
+/**
+ * O(n^2) Prim's algorithm, keeps the cheapest edge into every node in an array and scans it
+ * for the next node to add. Dense graphs relax straight from the rows of the matrix
+ * @tparam T is the type of the graph
+ * @return a vector of the edges in the tree
+ */
+template <typename T>
+vector<idEdge> Graph<T>::primDense() {
+    uint32_t n = getNumNodes();
+    vector<idEdge> tree;
+    vector<char> inTree(n, false);
+    vector<idEdge> best(n); // cheapest known edge into each node
+    for(uint32_t i = 0; i < n; i++){
+        best[i].from = i;
+        best[i].to = i;
+        best[i].weight = INT_MAX;   // no edge yet
+    }
+    idEdgeOrder order;
+    if(!dense)
+        buildAdjacency();
+    for(uint32_t added = 0; added < n; added++){
+        // the node with the cheapest edge into the tree, or the lowest id if none is reachable
+        uint32_t next = NO_ID;
+        for(uint32_t v = 0; v < n; v++)
+            if(!inTree[v] && (next == NO_ID || order(best[v], best[next])))
+                next = v;
+        inTree[next] = true;
+        if(best[next].weight != INT_MAX)
+            tree.push_back(best[next]);
+        if(!dense){
+            for(uint32_t i = offsets[next]; i < offsets[next + 1]; i++)
+                relaxPrim(next, adjacency[i], adjWeights[i], inTree, best);
+        }
+        else if(matrix.getType() == m_int16)
+            relaxRow(next, matrix.row<int16_t>(next), inTree, best);
+        else if(matrix.getType() == m_float)
+            relaxRow(next, matrix.row<float>(next), inTree, best);
+        else
+            relaxRow(next, matrix.row<int32_t>(next), inTree, best);
+    }
+    return tree;
+}
+
+/**
+ * Offers every edge in a matrix row to the nodes outside the tree
+ * @tparam T is the type of the graph
+ * @tparam W is the element type of the matrix
+ * @param from is the node that was just added to the tree
+ * @param row is its row of the matrix
+ * @param inTree marks the nodes already in the tree
+ * @param best is the cheapest known edge into every node
+ */
+template <typename T>
+template <typename W>
+void Graph<T>::relaxRow(uint32_t from, const W* row, const vector<char>& inTree, vector<idEdge>& best) {
+    for(uint32_t v = 0; v < getNumNodes(); v++)
+        if(row[v] != DistMatrix::missing<W>())
+            relaxPrim(from, v, static_cast<int>(lround(row[v])), inTree, best);
+}
+
+/**
+ * Replaces the cheapest known edge into a node if the new edge comes first in idEdgeOrder
+ * @tparam T is the type of the graph
+ * @param from is the node in the tree
+ * @param to is the node that may be outside the tree
+ * @param weight is the weight of the edge
+ * @param inTree marks the nodes already in the tree
+ * @param best is the cheapest known edge into every node
+ */
+template <typename T>
+void Graph<T>::relaxPrim(uint32_t from, uint32_t to, int weight, const vector<char>& inTree, vector<idEdge>& best) {
+    if(inTree[to])
+        return;
+    idEdge ed;
+    ed.from = from;
+    ed.to = to;
+    ed.weight = weight;
+    if(idEdgeOrder()(ed, best[to]))
+        best[to] = ed;
+}
+
+/**
+ * Prim's algorithm with an indexed heap, O(E log n) over the adjacency lists
+ * @tparam T is the type of the graph
+ * @return a vector of the edges in the tree
+ */
+template <typename T>
+vector<idEdge> Graph<T>::primSparse() {
+    uint32_t n = getNumNodes();
+    vector<idEdge> tree;
+    vector<char> inTree(n, false);
+    IndexedHeap<idEdge, idEdgeOrder> heap(n);
+    buildAdjacency();
+    for(uint32_t root = 0; root < n; root++){ // start a new tree in every component
+        if(inTree[root])
+            continue;
+        uint32_t cur = root;
+        while(true){
+            inTree[cur] = true;
+            for(uint32_t i = offsets[cur]; i < offsets[cur + 1]; i++){
+                if(inTree[adjacency[i]])
+                    continue;
+                idEdge ed;
+                ed.from = cur;
+                ed.to = adjacency[i];
+                ed.weight = adjWeights[i];
+                heap.decrease(ed.to, ed);
+            }
+            if(heap.empty())
+                break;
+            cur = heap.pop();
+            tree.push_back(heap.getKey(cur));
+        }
+    }
+    return tree;
+}
+
+/**
+ * Parallel Boruvka's algorithm. Every round finds the lightest edge leaving each component
+ * across the thread pool, joins the components along those edges with a lock free union
+ * find, and drops the edges that now sit inside one component. idEdgeOrder decides every
+ * comparison, so the result is the same tree the serial algorithms return for any number
+ * of threads
+ * @tparam T is the type of the graph
+ * @return a vector of the edges in the tree, sorted by idEdgeOrder
+ */
+template <typename T>
+vector<idEdge> Graph<T>::boruvka() {
+    uint32_t n = getNumNodes();
+    vector<idEdge> tree;
+    ThreadPool pool(threads);
+    ConcurrentDisjointSet comps(n);
+    idEdgeOrder order;
+    vector<idEdge> live;    // edges that still join two components
+    forEachEdge([&](const idEdge& e) {
+        if(e.from != e.to)
+            live.push_back(e);
+    });
+    // the index in live of the lightest edge leaving each component, by root
+    unique_ptr<atomic<uint32_t>[]> cheapest(new atomic<uint32_t>[n]);
+    vector<vector<idEdge>> chunks(pool.getSize());
+    // parallel edges of equal weight are told apart by position so the winner is fixed
+    auto lighter = [&](uint32_t one, uint32_t two) {
+        if(order(live[one], live[two]))
+            return true;
+        return !order(live[two], live[one]) && one < two;
+    };
+    auto offer = [&](atomic<uint32_t>& slot, uint32_t ed) {
+        uint32_t cur = slot.load(memory_order_relaxed);
+        while((cur == NO_ID || lighter(ed, cur)) && !slot.compare_exchange_weak(cur, ed, memory_order_relaxed))
+            ;
+    };
+    while(!live.empty()){
+        pool.parallelFor(0, n, [&](size_t lo, size_t hi, unsigned) {
+            for(size_t i = lo; i < hi; i++)
+                cheapest[i].store(NO_ID, memory_order_relaxed);
+        });
+        pool.parallelFor(0, live.size(), [&](size_t lo, size_t hi, unsigned) {
+            for(size_t i = lo; i < hi; i++){
+                uint32_t one = comps.find(live[i].from);
+                uint32_t two = comps.find(live[i].to);
+                if(one == two)
+                    continue;
+                offer(cheapest[one], static_cast<uint32_t>(i));
+                offer(cheapest[two], static_cast<uint32_t>(i));
+            }
+        });
+        // both components an edge joins may have picked it, only the union that joins them keeps it
+        pool.parallelFor(0, n, [&](size_t lo, size_t hi, unsigned c) {
+            for(size_t r = lo; r < hi; r++){
+                uint32_t ed = cheapest[r].load(memory_order_relaxed);
+                if(ed != NO_ID && comps.union_(live[ed].from, live[ed].to))
+                    chunks[c].push_back(live[ed]);
+            }
+        });
+        bool joined = false;
+        for(unsigned int c = 0; c < chunks.size(); c++){
+            joined = joined || !chunks[c].empty();
+            tree.insert(tree.end(), chunks[c].begin(), chunks[c].end());
+            chunks[c].clear();
+        }
+        if(!joined)
+            break;
+        // keep the edges that still leave their component, in their original order
+        pool.parallelFor(0, live.size(), [&](size_t lo, size_t hi, unsigned c) {
+            for(size_t i = lo; i < hi; i++)
+                if(comps.find(live[i].from) != comps.find(live[i].to))
+                    chunks[c].push_back(live[i]);
+        });
+        live.clear();
+        for(unsigned int c = 0; c < chunks.size(); c++){
+            live.insert(live.end(), chunks[c].begin(), chunks[c].end());
+            chunks[c].clear();
+        }
+    }
+    sort(tree.begin(), tree.end(), order);
+    return tree;
+}
+
 /**
  * prints out each node and their connections in the graph
  * @tparam T is the type of the graph
  */
 template <typename T>
 void Graph<T>::printGraph() {
-    for(auto iter = nodes.begin(); iter != nodes.end(); iter++){
-        Node nd = iter->second;
-        cout << nd.obj << ":" << endl;
-        for(int i = 0; i < nd.edges.size(); i++){
-            cout << "\t" << nd.edges[i] << endl;
+    buildAdjacency();
+    for(uint32_t nd = 0; nd < getNumNodes(); nd++){
+        cout << labels[nd] << ":" << endl;
+        for(uint32_t i = offsets[nd]; i < offsets[nd + 1]; i++){
+            cout << "\t" << labels[adjacency[i]] << endl;
         }
     }
 }
@@ -742,20 +1348,120 @@ void Graph<T>::printGraph() {
 template <typename T>
 int Graph<T>::calcWeights(vector<T> vec) {
     int sum = 0;
-    for(int i = 0; i < vec.size() - 1; i ++){
-        T cur = vec[i];
-        T next = vec[i+1];
-        weightEdge<T> wE;
-        for(int j = 0; j < weights.size(); j++){
-            wE = weights[j];
-            if(wE.to == cur || wE.to == next){ //undirected
-                if(wE.from == cur || wE.from == next){
-                    break;
-                }
-            }
+    for(unsigned int i = 0; i + 1 < vec.size(); i ++){
+        uint32_t cur = getId(vec[i]);
+        uint32_t next = getId(vec[i+1]);
+        int weight = -1;
+        if(cur != NO_ID && next != NO_ID)
+            weight = getWeight(cur, next);
+        if(weight == -1) {  // the path uses a pair of nodes that aren't connected
+            cout << "No edge between " << vec[i] << " and " << vec[i+1] << endl;
+            continue;
         }
-        sum += wE.weight;
+        sum += weight;
     }
     return sum;
 }
+
+/**
+ * Calculates the cost of a closed tour by id, including the edge back to the start
+ * @tparam T is the type of the graph
+ * @param tour is the order the ids are visited in
+ * @return the cost of the tour, missing edges count as 0
+ */
+template <typename T>
+long long Graph<T>::tourCost(const vector<uint32_t>& tour) const {
+    long long sum = 0;
+    for(unsigned int i = 0; i < tour.size(); i++){
+        int weight = getWeight(tour[i], tour[(i + 1) % tour.size()]);
+        if(weight != -1)
+            sum += weight;
+    }
+    return sum;
+}
+/**
+ * Replaces the edges with the shortest path metric closure, so every pair of nodes is
+ * connected by an edge as long as the shortest path between them. Call once the graph is
+ * built, the shortest paths are kept so expandPath can turn a tour back into real edges.
+ * The closure takes O(n^2) memory whatever the graph, so it is only built if it and the
+ * storage for its edges fit in the memory budget
+ * @tparam T is the type of the graph
+ * @return false if the graph isn't connected or is too large, in which case it is left
+ * unchanged
+ */
+template <typename T>
+bool Graph<T>::closeMetric() {
+    uint32_t n = getNumNodes();
+    uint64_t pairs = static_cast<uint64_t>(n) * (n - 1) / 2;
+    apsp_Type tp = apspType == apsp_auto ? MetricClosure::pick(n, numEdges) : apspType;
+    // sparse storage takes an edge and a hash table entry for every pair
+    size_t sparseBytes = pairs * (sizeof(idEdge) + sizeof(pair<const uint64_t, int>) + 2 * sizeof(void*));
+    size_t storageBytes = storage == s_sparse ? sparseBytes : DistMatrix::bytesFor(n, matrixType);
+    if(MetricClosure::bytes(n, tp) + storageBytes > closureMemory) {
+        cout << "Graph is too large for the metric closure" << endl;
+        return false;
+    }
+    bool connected = dense ? closure.compute(n, getEdges(), tp, threads) : closure.compute(n, edgeList, tp, threads);
+    if(!connected) {
+        cout << "Graph is not connected, no metric closure" << endl;
+        closure.clear();
+        return false;
+    }
+    bool fits = storage != s_sparse;
+    for(uint32_t i = 0; i < n && fits; i++)
+        for(uint32_t j = i + 1; j < n && fits; j++)
+            fits = DistMatrix::fits(closure.getDistance(i, j), matrixType);
+    if(!fits && storage != s_sparse && MetricClosure::bytes(n, tp) + sparseBytes > closureMemory) {
+        cout << "Graph is too large for the metric closure in sparse storage" << endl;
+        closure.clear();
+        return false;
+    }
+    numEdges = pairs;
+    spanValid = false;
+    indexValid = false;
+    vector<idEdge>().swap(edgeList);
+    unordered_map<uint64_t, int>().swap(edgeIndex);
+    freeAdjacency();
+    dense = false;
+    if(fits) {  // fill the matrix straight from the closure, without an edge list or hash index
+        matrix.resize(n, matrixType);
+        for(uint32_t i = 0; i < n; i++)
+            for(uint32_t j = i + 1; j < n; j++)
+                matrix.set(i, j, closure.getDistance(i, j));
+        dense = true;
+    }
+    else {
+        matrix.clear();
+        edgeList.reserve(pairs);
+        for(uint32_t i = 0; i < n; i++)
+            for(uint32_t j = i + 1; j < n; j++)
+                edgeList.push_back(idEdge{i, j, closure.getDistance(i, j)});
+        indexEdges();
+    }
+    buildIndex();
+    return true;
+}
+
+/**
+ * Expands every edge of a path over the metric closure into the shortest path it stands
+ * for, nodes are repeated wherever the real path passes through them
+ * @tparam T is the type of the graph
+ * @param path is a path over the closure
+ * @return the path over the original edges, or the path itself if there is no closure
+ */
+template <typename T>
+vector<T> Graph<T>::expandPath(const vector<T>& path) const {
+    if(!isClosed() || path.empty())
+        return path;
+    vector<uint32_t> hops;
+    hops.push_back(getId(path[0]));
+    for(unsigned int i = 0; i + 1 < path.size(); i++)
+        closure.expand(getId(path[i]), getId(path[i + 1]), hops);
+    vector<T> toReturn;
+    toReturn.reserve(hops.size());
+    for(unsigned int i = 0; i < hops.size(); i++)
+        toReturn.push_back(labels[hops[i]]);
+    return toReturn;
+}
+
 #endif //INC_20S_PA02_RANIROGAN_GRAPH_H
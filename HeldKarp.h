@@ -0,0 +1,241 @@
+/**
+ * Held-Karp lower bound
+ * Every tour is a 1-tree, and adding a penalty to both ends of every edge at a node adds twice
+ * the penalty to every tour but not to every 1-tree, so the lightest 1-tree minus twice the
+ * penalties is a lower bound for any penalties. Subgradient ascent raises the penalty on nodes
+ * of degree more than 2 and lowers it on leaves, which pushes the 1-tree towards a tour and the
+ * bound up. The ascent runs on the candidate edges plus the graph's spanning tree, keeping the
+ * edges in their last sorted order so each step only has to repair the order the penalties
+ * moved, and the bound from the best penalties is checked on the whole graph at the end
+ */
+
+#ifndef TSP_HELDKARP_H
+#define TSP_HELDKARP_H
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include "Graph.h"
+#include "NN.h"
+#include "OneTree.h"
+#include "Candidates.h"
+#include "DisjointSet.h"
+
+using namespace std;
+
+template <typename T>
+class HeldKarp{
+public:
+    explicit HeldKarp(Graph<T>& gr) : graph(gr) {}
+    long long bound(long long upper = 0);
+    void setIterations(uint32_t count) {maxIterations = count;}
+    void setNeighbors(uint32_t k) {neighbors = k;}
+    void setThreads(unsigned count) {threads = count;}
+    const vector<double>& getPenalties() const {return best;}
+    uint32_t getIterations() const {return iterations;}
+    bool isTour() const {return tour;}
+private:
+    Graph<T>& graph;
+    uint32_t maxIterations = 1000;
+    uint32_t neighbors = 10;    // candidate edges per node the ascent works on
+    unsigned threads = 0;       // 0 uses every hardware thread
+    uint32_t iterations = 0;
+    bool tour = false;          // the final 1-tree is a tour, so the bound is its length
+    vector<double> best;        // penalties of the best bound found
+    vector<idEdge> edges;       // the subgraph the ascent works on
+    vector<uint32_t> offsets;   // edges at each node, indexes into edges
+    vector<uint32_t> incident;
+    double oneTree(const vector<double>& pi, vector<uint32_t>& order, vector<double>& cost, vector<int>& degree);
+    static void repair(vector<uint32_t>& order, const vector<double>& cost);
+};
+
+/**
+ * Runs the subgradient ascent. The step follows Polyak's rule towards an upper bound, is
+ * smoothed with the last direction, and halves whenever the bound stops rising for a while
+ * @tparam T is the type of the graph
+ * @param upper is the length of a known tour, 0 builds one with nearest neighbor
+ * @return the lower bound, rounded up since the weights are integers
+ */
+template <typename T>
+long long HeldKarp<T>::bound(long long upper) {
+    graph.buildIndex();
+    if(!graph.isDense())
+        graph.buildAdjacency();
+    uint32_t n = graph.getNumNodes();
+    iterations = 0;
+    tour = false;
+    best.assign(n, 0);
+    if(n < 3)
+        return 0;
+    if(upper <= 0)
+        upper = graph.tourCost(NN<T>::tourFrom(graph, 0));
+    // the candidate edges plus a spanning tree, so the subgraph is connected
+    edges = graph.getMinSpanIds();
+    if(graph.isDense()) {
+        CandidateSet cand;
+        cand.build(graph, neighbors, threads);
+        for(uint32_t i = 0; i < n; i++){
+            for(uint32_t j = 0; j < cand.count(i); j++){
+                uint32_t to = cand.get(i)[j];
+                const uint32_t* back = cand.get(to);
+                // an edge in both lists is only added from its lower end
+                if(to < i && find(back, back + cand.count(to), i) != back + cand.count(to))
+                    continue;
+                edges.push_back(idEdge{i, to, graph.getWeight(i, to)});
+            }
+        }
+    }
+    else {
+        graph.forEachEdge([&](const idEdge& e) {
+            if(e.from != e.to)
+                edges.push_back(e);
+        });
+    }
+    offsets.assign(n + 1, 0);
+    incident.assign(2 * edges.size(), 0);
+    for(const idEdge& e : edges){
+        offsets[e.from + 1]++;
+        offsets[e.to + 1]++;
+    }
+    for(uint32_t i = 0; i < n; i++)
+        offsets[i + 1] += offsets[i];
+    vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for(uint32_t e = 0; e < edges.size(); e++){
+        incident[fill[edges[e].from]++] = e;
+        incident[fill[edges[e].to]++] = e;
+    }
+    vector<uint32_t> order(edges.size());
+    for(uint32_t e = 0; e < order.size(); e++)
+        order[e] = e;
+    vector<double> cost(edges.size()), pi(n, 0);
+    vector<int> degree(n), last(n, 0);
+    double bestBound = numeric_limits<double>::lowest(), scale = 2;
+    uint32_t period = max<uint32_t>(10, min<uint32_t>(100, n / 2)), stall = 0;
+    for(; iterations < maxIterations; iterations++){
+        double w = oneTree(pi, order, cost, degree);
+        if(w > bestBound + 1e-9) {
+            bestBound = w;
+            best = pi;
+            stall = 0;
+        }
+        else if(++stall >= period) {
+            scale /= 2;
+            stall = 0;
+            if(scale < 1e-3)
+                break;
+        }
+        double norm = 0;
+        for(uint32_t i = 0; i < n; i++)
+            norm += static_cast<double>(degree[i] - 2) * (degree[i] - 2);
+        if(norm == 0 || upper - w <= 0)     // the 1-tree is a tour or meets the upper bound
+            break;
+        double step = scale * (upper - w) / norm;
+        for(uint32_t i = 0; i < n; i++){
+            pi[i] += step * (0.7 * (degree[i] - 2) + 0.3 * last[i]);
+            last[i] = degree[i] - 2;
+        }
+    }
+    // the subgraph's 1-tree can be heavier than the graph's, only the whole graph gives a bound
+    OneTree full;
+    full.build(graph, OneTree::span(graph, best), best);
+    double total = full.getLength();
+    for(uint32_t i = 0; i < n; i++)
+        total -= 2 * best[i];
+    tour = true;
+    for(uint32_t i = 0; i < n && tour; i++)
+        tour = full.getDegree(i) == 2;
+    return static_cast<long long>(ceil(total - 1e-6));
+}
+
+/**
+ * Finds the lightest 1-tree of the subgraph with Kruskal's algorithm, with the leaf of the
+ * spanning tree whose next lightest edge is heaviest as the special node
+ * @tparam T is the type of the graph
+ * @param pi is the penalty on every node
+ * @param order is the edge order from the last call, sorted again for these penalties
+ * @param cost is set to the penalized cost of every edge
+ * @param degree is set to the degree of every node in the 1-tree
+ * @return the length of the 1-tree minus twice the penalties
+ */
+template <typename T>
+double HeldKarp<T>::oneTree(const vector<double>& pi, vector<uint32_t>& order, vector<double>& cost, vector<int>& degree) {
+    uint32_t n = static_cast<uint32_t>(pi.size());
+    for(uint32_t e = 0; e < edges.size(); e++)
+        cost[e] = edges[e].weight + pi[edges[e].from] + pi[edges[e].to];
+    repair(order, cost);
+    DisjointSet sets(n);
+    fill(degree.begin(), degree.end(), 0);
+    vector<bool> inTree(edges.size(), false);
+    double length = 0;
+    for(uint32_t e : order){
+        if(!sets.union_(edges[e].from, edges[e].to))
+            continue;
+        inTree[e] = true;
+        degree[edges[e].from]++;
+        degree[edges[e].to]++;
+        length += cost[e];
+    }
+    // the special leaf takes its lightest edge outside the tree
+    uint32_t special = NO_ID, other = NO_ID;
+    double secondCost = 0;
+    for(uint32_t leaf = 0; leaf < n; leaf++){
+        if(degree[leaf] != 1)
+            continue;
+        uint32_t near = NO_ID, tie = NO_ID;
+        double nearCost = numeric_limits<double>::infinity();
+        for(uint32_t j = offsets[leaf]; j < offsets[leaf + 1]; j++){
+            if(inTree[incident[j]])
+                tie = edges[incident[j]].from == leaf ? edges[incident[j]].to : edges[incident[j]].from;
+        }
+        for(uint32_t j = offsets[leaf]; j < offsets[leaf + 1]; j++){
+            const idEdge& e = edges[incident[j]];
+            uint32_t to = e.from == leaf ? e.to : e.from;
+            if(to != tie && to != leaf && cost[incident[j]] < nearCost) {
+                nearCost = cost[incident[j]];
+                near = to;
+            }
+        }
+        if(near != NO_ID && (special == NO_ID || nearCost > secondCost)) {
+            special = leaf;
+            other = near;
+            secondCost = nearCost;
+        }
+    }
+    if(special != NO_ID) {
+        length += secondCost;
+        degree[special]++;
+        degree[other]++;
+    }
+    for(uint32_t i = 0; i < n; i++)
+        length -= 2 * pi[i];
+    return length;
+}
+
+/**
+ * Sorts the edges by cost again. The penalties move a little each step, so the last order
+ * is nearly sorted and insertion sort fixes it in close to linear time. Early steps move
+ * more, so once the shifts pass a few per edge it gives up and sorts from scratch
+ * @tparam T is the type of the graph
+ * @param order is the edge order to repair
+ * @param cost is the cost of every edge
+ */
+template <typename T>
+void HeldKarp<T>::repair(vector<uint32_t>& order, const vector<double>& cost) {
+    auto less = [&](uint32_t a, uint32_t b) {return cost[a] != cost[b] ? cost[a] < cost[b] : a < b;};
+    size_t shifts = 0, limit = 8 * order.size();
+    for(size_t i = 1; i < order.size(); i++){
+        uint32_t e = order[i];
+        size_t j = i;
+        for(; j > 0 && less(e, order[j - 1]); j--)
+            order[j] = order[j - 1];
+        order[j] = e;
+        shifts += i - j;
+        if(shifts > limit) {
+            sort(order.begin(), order.end(), less);
+            return;
+        }
+    }
+}
+
+#endif //TSP_HELDKARP_H
@@ -0,0 +1,128 @@
+/**
+ * Binary min heap over dense ids that supports lowering the key of an id already in the heap
+ * The position of every id is tracked so decrease key is O(log n) without a search
+ */
+
+#ifndef TSP_INDEXEDHEAP_H
+#define TSP_INDEXEDHEAP_H
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "various.h"
+
+using namespace std;
+
+template <typename K, typename Compare = less<K>>
+class IndexedHeap{
+public:
+    explicit IndexedHeap(uint32_t size = 0) : pos(size, NO_ID), keys(size) {}
+    bool empty() const {return heap.empty();}
+    bool contains(uint32_t id) const {return pos[id] != NO_ID;}
+    uint32_t top() const {return heap[0];}
+    const K& getKey(uint32_t id) const {return keys[id];}
+    void push(uint32_t id, const K& key);
+    bool decrease(uint32_t id, const K& key);
+    uint32_t pop();
+private:
+    vector<uint32_t> heap;  // ids in heap order
+    vector<uint32_t> pos;   // where every id is in heap, NO_ID if it isn't
+    vector<K> keys;
+    Compare comp;
+    void siftUp(uint32_t i);
+    void siftDown(uint32_t i);
+    void place(uint32_t i, uint32_t id) {heap[i] = id; pos[id] = i;}
+};
+
+/**
+ * Adds an id to the heap
+ * @tparam K is the key type
+ * @param id is the id to add, it must not already be in the heap
+ * @param key is its key
+ */
+template <typename K, typename Compare>
+void IndexedHeap<K, Compare>::push(uint32_t id, const K& key) {
+    keys[id] = key;
+    heap.push_back(id);
+    pos[id] = static_cast<uint32_t>(heap.size() - 1);
+    siftUp(pos[id]);
+}
+
+/**
+ * Lowers the key of an id, adding it if it isn't in the heap
+ * @tparam K is the key type
+ * @param id is the id to update
+ * @param key is the new key
+ * @return true if the key was lowered or the id added
+ */
+template <typename K, typename Compare>
+bool IndexedHeap<K, Compare>::decrease(uint32_t id, const K& key) {
+    if(!contains(id)){
+        push(id, key);
+        return true;
+    }
+    if(!comp(key, keys[id]))
+        return false;
+    keys[id] = key;
+    siftUp(pos[id]);
+    return true;
+}
+
+/**
+ * Removes the id with the smallest key
+ * @tparam K is the key type
+ * @return the removed id
+ */
+template <typename K, typename Compare>
+uint32_t IndexedHeap<K, Compare>::pop() {
+    uint32_t id = heap[0];
+    uint32_t last = heap.back();
+    heap.pop_back();
+    pos[id] = NO_ID;
+    if(!heap.empty()){
+        place(0, last);
+        siftDown(0);
+    }
+    return id;
+}
+
+/**
+ * Moves the id at a position up until its parent is smaller
+ * @tparam K is the key type
+ * @param i is the position in the heap
+ */
+template <typename K, typename Compare>
+void IndexedHeap<K, Compare>::siftUp(uint32_t i) {
+    uint32_t id = heap[i];
+    while(i > 0){
+        uint32_t parent = (i - 1) / 2;
+        if(!comp(keys[id], keys[heap[parent]]))
+            break;
+        place(i, heap[parent]);
+        i = parent;
+    }
+    place(i, id);
+}
+
+/**
+ * Moves the id at a position down until both children are larger
+ * @tparam K is the key type
+ * @param i is the position in the heap
+ */
+template <typename K, typename Compare>
+void IndexedHeap<K, Compare>::siftDown(uint32_t i) {
+    uint32_t id = heap[i];
+    uint32_t size = static_cast<uint32_t>(heap.size());
+    while(2 * i + 1 < size){
+        uint32_t child = 2 * i + 1;
+        if(child + 1 < size && comp(keys[heap[child + 1]], keys[heap[child]]))
+            child++;
+        if(!comp(keys[heap[child]], keys[id]))
+            break;
+        place(i, heap[child]);
+        i = child;
+    }
+    place(i, id);
+}
+
+#endif //TSP_INDEXEDHEAP_H
@@ -0,0 +1,469 @@
+/**
+ * Vectorized inner loops shared by the solvers
+ * Each kernel has a scalar version and AVX2 / SSE4.1 versions on x86. The widest one the
+ * cpu supports is picked at runtime, and every version returns exactly the same answer
+ */
+
+#ifndef TSP_KERNELS_H
+#define TSP_KERNELS_H
+
+#include <cstdint>
+#include <limits>
+#include "various.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TSP_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+enum simd_Type{simd_scalar, simd_sse41, simd_avx2};
+
+/**
+ * Finds the widest instruction set the cpu supports
+ * @return the best kernel level
+ */
+inline simd_Type simdLevel() {
+#ifdef TSP_X86_KERNELS
+    static const simd_Type level = __builtin_cpu_supports("avx2") ? simd_avx2 :
+                                   (__builtin_cpu_supports("sse4.1") ? simd_sse41 : simd_scalar);
+    return level;
+#else
+    return simd_scalar;
+#endif
+}
+
+/**
+ * Checks a bit in a bitmap
+ * @param bits is the bitmap
+ * @param i is the bit to check
+ * @return true if the bit is set
+ */
+inline bool testBit(const uint64_t* bits, uint32_t i) {
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+/**
+ * Scalar masked argmin, the reference every vector version matches
+ * @tparam W is the element type
+ * @param row is the row to search
+ * @param visited is a bitmap of the columns to skip
+ * @param begin is the first column to look at
+ * @param n is the number of columns
+ * @param best is the smallest value so far, updated
+ * @param bestIndex is the column of best, updated
+ */
+template <typename W>
+inline void argminScalar(const W* row, const uint64_t* visited, uint32_t begin, uint32_t n, W& best, uint32_t& bestIndex) {
+    for(uint32_t j = begin; j < n; j++){
+        if(row[j] < best && !testBit(visited, j)){
+            best = row[j];
+            bestIndex = j;
+        }
+    }
+}
+
+#ifdef TSP_X86_KERNELS
+/**
+ * Turns 8 bits of the visited bitmap into a lane mask, all ones where the column is visited
+ * @param bits is the 8 bits for the block of columns
+ * @return the lane mask
+ */
+__attribute__((target("avx2")))
+inline __m256i visitedLanes8(uint32_t bits) {
+    const __m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    return _mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), lane), lane);
+}
+
+/**
+ * Turns 4 bits of the visited bitmap into a lane mask, all ones where the column is visited
+ * @param bits is the 4 bits for the block of columns
+ * @return the lane mask
+ */
+__attribute__((target("sse4.1")))
+inline __m128i visitedLanes4(uint32_t bits) {
+    const __m128i lane = _mm_setr_epi32(1, 2, 4, 8);
+    return _mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), lane), lane);
+}
+
+/**
+ * AVX2 masked argmin over 32 bit integers, keeps a running minimum and its column in every lane
+ * and reduces the lanes at the end, taking the lowest column among equal minimums
+ * @tparam W is int32_t or int16_t, int16_t rows are widened on load
+ */
+template <typename W>
+__attribute__((target("avx2")))
+uint32_t argminAvx2Int(const W* row, const uint64_t* visited, uint32_t n) {
+    const __m256i blocked = _mm256_set1_epi32(numeric_limits<int32_t>::max());
+    __m256i best = blocked;
+    __m256i bestIndex = _mm256_set1_epi32(-1);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i step = _mm256_set1_epi32(8);
+    uint32_t j = 0;
+    for(; j + 8 <= n; j += 8){
+        __m256i vals;
+        if(sizeof(W) == 2)
+            vals = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + j)));
+        else
+            vals = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + j));
+        uint32_t bits = static_cast<uint32_t>(visited[j >> 6] >> (j & 63)) & 0xFF;
+        vals = _mm256_blendv_epi8(vals, blocked, visitedLanes8(bits));
+        __m256i less = _mm256_cmpgt_epi32(best, vals);
+        best = _mm256_blendv_epi8(best, vals, less);
+        bestIndex = _mm256_blendv_epi8(bestIndex, index, less);
+        index = _mm256_add_epi32(index, step);
+    }
+    alignas(32) int32_t lanes[8];
+    alignas(32) int32_t laneIndex[8];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), best);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(laneIndex), bestIndex);
+    W bestVal = numeric_limits<W>::max();
+    uint32_t bestAt = NO_ID;
+    for(int l = 0; l < 8; l++){
+        if(laneIndex[l] < 0)
+            continue;
+        if(lanes[l] < bestVal || (lanes[l] == bestVal && bestAt != NO_ID && static_cast<uint32_t>(laneIndex[l]) < bestAt)){
+            bestVal = static_cast<W>(lanes[l]);
+            bestAt = static_cast<uint32_t>(laneIndex[l]);
+        }
+    }
+    argminScalar(row, visited, j, n, bestVal, bestAt);
+    return bestAt;
+}
+
+/**
+ * AVX2 masked argmin over floats
+ */
+__attribute__((target("avx2")))
+inline uint32_t argminAvx2Float(const float* row, const uint64_t* visited, uint32_t n) {
+    const __m256 blocked = _mm256_set1_ps(numeric_limits<float>::max());
+    __m256 best = blocked;
+    __m256i bestIndex = _mm256_set1_epi32(-1);
+    __m256i index = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i step = _mm256_set1_epi32(8);
+    uint32_t j = 0;
+    for(; j + 8 <= n; j += 8){
+        __m256 vals = _mm256_loadu_ps(row + j);
+        uint32_t bits = static_cast<uint32_t>(visited[j >> 6] >> (j & 63)) & 0xFF;
+        vals = _mm256_blendv_ps(vals, blocked, _mm256_castsi256_ps(visitedLanes8(bits)));
+        __m256 less = _mm256_cmp_ps(vals, best, _CMP_LT_OQ);
+        best = _mm256_blendv_ps(best, vals, less);
+        bestIndex = _mm256_blendv_epi8(bestIndex, index, _mm256_castps_si256(less));
+        index = _mm256_add_epi32(index, step);
+    }
+    alignas(32) float lanes[8];
+    alignas(32) int32_t laneIndex[8];
+    _mm256_store_ps(lanes, best);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(laneIndex), bestIndex);
+    float bestVal = numeric_limits<float>::max();
+    uint32_t bestAt = NO_ID;
+    for(int l = 0; l < 8; l++){
+        if(laneIndex[l] < 0)
+            continue;
+        if(lanes[l] < bestVal || (lanes[l] == bestVal && bestAt != NO_ID && static_cast<uint32_t>(laneIndex[l]) < bestAt)){
+            bestVal = lanes[l];
+            bestAt = static_cast<uint32_t>(laneIndex[l]);
+        }
+    }
+    argminScalar(row, visited, j, n, bestVal, bestAt);
+    return bestAt;
+}
+
+/**
+ * SSE4.1 masked argmin over 32 bit integers
+ * @tparam W is int32_t or int16_t, int16_t rows are widened on load
+ */
+template <typename W>
+__attribute__((target("sse4.1")))
+uint32_t argminSse41Int(const W* row, const uint64_t* visited, uint32_t n) {
+    const __m128i blocked = _mm_set1_epi32(numeric_limits<int32_t>::max());
+    __m128i best = blocked;
+    __m128i bestIndex = _mm_set1_epi32(-1);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i step = _mm_set1_epi32(4);
+    uint32_t j = 0;
+    for(; j + 4 <= n; j += 4){
+        __m128i vals;
+        if(sizeof(W) == 2)
+            vals = _mm_cvtepi16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + j)));
+        else
+            vals = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + j));
+        uint32_t bits = static_cast<uint32_t>(visited[j >> 6] >> (j & 63)) & 0xF;
+        vals = _mm_blendv_epi8(vals, blocked, visitedLanes4(bits));
+        __m128i less = _mm_cmpgt_epi32(best, vals);
+        best = _mm_blendv_epi8(best, vals, less);
+        bestIndex = _mm_blendv_epi8(bestIndex, index, less);
+        index = _mm_add_epi32(index, step);
+    }
+    alignas(16) int32_t lanes[4];
+    alignas(16) int32_t laneIndex[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), best);
+    _mm_store_si128(reinterpret_cast<__m128i*>(laneIndex), bestIndex);
+    W bestVal = numeric_limits<W>::max();
+    uint32_t bestAt = NO_ID;
+    for(int l = 0; l < 4; l++){
+        if(laneIndex[l] < 0)
+            continue;
+        if(lanes[l] < bestVal || (lanes[l] == bestVal && bestAt != NO_ID && static_cast<uint32_t>(laneIndex[l]) < bestAt)){
+            bestVal = static_cast<W>(lanes[l]);
+            bestAt = static_cast<uint32_t>(laneIndex[l]);
+        }
+    }
+    argminScalar(row, visited, j, n, bestVal, bestAt);
+    return bestAt;
+}
+
+/**
+ * SSE4.1 masked argmin over floats
+ */
+__attribute__((target("sse4.1")))
+inline uint32_t argminSse41Float(const float* row, const uint64_t* visited, uint32_t n) {
+    const __m128 blocked = _mm_set1_ps(numeric_limits<float>::max());
+    __m128 best = blocked;
+    __m128i bestIndex = _mm_set1_epi32(-1);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i step = _mm_set1_epi32(4);
+    uint32_t j = 0;
+    for(; j + 4 <= n; j += 4){
+        __m128 vals = _mm_loadu_ps(row + j);
+        uint32_t bits = static_cast<uint32_t>(visited[j >> 6] >> (j & 63)) & 0xF;
+        vals = _mm_blendv_ps(vals, blocked, _mm_castsi128_ps(visitedLanes4(bits)));
+        __m128 less = _mm_cmplt_ps(vals, best);
+        best = _mm_blendv_ps(best, vals, less);
+        bestIndex = _mm_blendv_epi8(bestIndex, index, _mm_castps_si128(less));
+        index = _mm_add_epi32(index, step);
+    }
+    alignas(16) float lanes[4];
+    alignas(16) int32_t laneIndex[4];
+    _mm_store_ps(lanes, best);
+    _mm_store_si128(reinterpret_cast<__m128i*>(laneIndex), bestIndex);
+    float bestVal = numeric_limits<float>::max();
+    uint32_t bestAt = NO_ID;
+    for(int l = 0; l < 4; l++){
+        if(laneIndex[l] < 0)
+            continue;
+        if(lanes[l] < bestVal || (lanes[l] == bestVal && bestAt != NO_ID && static_cast<uint32_t>(laneIndex[l]) < bestAt)){
+            bestVal = lanes[l];
+            bestAt = static_cast<uint32_t>(laneIndex[l]);
+        }
+    }
+    argminScalar(row, visited, j, n, bestVal, bestAt);
+    return bestAt;
+}
+#endif
+
+/**
+ * Finds the smallest entry of a row among the columns that aren't visited. The largest value
+ * of the element type marks a missing entry and is never returned
+ * @param row is the row to search
+ * @param visited is a bitmap with at least n bits, set for the columns to skip
+ * @param n is the number of columns
+ * @param level is the kernel to use, defaults to the widest the cpu supports
+ * @return the lowest column holding the smallest entry, NO_ID if there is none
+ */
+inline uint32_t maskedArgmin(const int32_t* row, const uint64_t* visited, uint32_t n, simd_Type level = simdLevel()) {
+#ifdef TSP_X86_KERNELS
+    if(level == simd_avx2)
+        return argminAvx2Int(row, visited, n);
+    if(level == simd_sse41)
+        return argminSse41Int(row, visited, n);
+#endif
+    int32_t best = numeric_limits<int32_t>::max();
+    uint32_t bestIndex = NO_ID;
+    argminScalar(row, visited, 0, n, best, bestIndex);
+    return bestIndex;
+}
+
+/**
+ * Finds the smallest entry of a 16 bit row among the columns that aren't visited
+ * @see maskedArgmin(const int32_t*, const uint64_t*, uint32_t, simd_Type)
+ */
+inline uint32_t maskedArgmin(const int16_t* row, const uint64_t* visited, uint32_t n, simd_Type level = simdLevel()) {
+#ifdef TSP_X86_KERNELS
+    if(level == simd_avx2)
+        return argminAvx2Int(row, visited, n);
+    if(level == simd_sse41)
+        return argminSse41Int(row, visited, n);
+#endif
+    int16_t best = numeric_limits<int16_t>::max();
+    uint32_t bestIndex = NO_ID;
+    argminScalar(row, visited, 0, n, best, bestIndex);
+    return bestIndex;
+}
+
+/**
+ * Finds the smallest entry of a float row among the columns that aren't visited
+ * @see maskedArgmin(const int32_t*, const uint64_t*, uint32_t, simd_Type)
+ */
+inline uint32_t maskedArgmin(const float* row, const uint64_t* visited, uint32_t n, simd_Type level = simdLevel()) {
+#ifdef TSP_X86_KERNELS
+    if(level == simd_avx2)
+        return argminAvx2Float(row, visited, n);
+    if(level == simd_sse41)
+        return argminSse41Float(row, visited, n);
+#endif
+    float best = numeric_limits<float>::max();
+    uint32_t bestIndex = NO_ID;
+    argminScalar(row, visited, 0, n, best, bestIndex);
+    return bestIndex;
+}
+
+/**
+ * Scalar scale and clamp, the reference every vector version matches
+ * @param data is the array to change
+ * @param begin is the first element to change
+ * @param count is the number of elements
+ * @param scale multiplies every element
+ * @param lo is the smallest value kept
+ * @param hi is the largest value kept
+ */
+inline void scaleClampScalar(float* data, size_t begin, size_t count, float scale, float lo, float hi) {
+    for(size_t i = begin; i < count; i++){
+        float v = data[i] * scale;
+        v = v < lo ? lo : v;
+        data[i] = v > hi ? hi : v;
+    }
+}
+
+#ifdef TSP_X86_KERNELS
+/**
+ * AVX2 scale and clamp, 8 floats at a time
+ */
+__attribute__((target("avx2")))
+inline void scaleClampAvx2(float* data, size_t count, float scale, float lo, float hi) {
+    const __m256 s = _mm256_set1_ps(scale), l = _mm256_set1_ps(lo), h = _mm256_set1_ps(hi);
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8){
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(data + i), s);
+        _mm256_storeu_ps(data + i, _mm256_min_ps(_mm256_max_ps(v, l), h));
+    }
+    scaleClampScalar(data, i, count, scale, lo, hi);
+}
+
+/**
+ * SSE4.1 scale and clamp, 4 floats at a time
+ */
+__attribute__((target("sse4.1")))
+inline void scaleClampSse41(float* data, size_t count, float scale, float lo, float hi) {
+    const __m128 s = _mm_set1_ps(scale), l = _mm_set1_ps(lo), h = _mm_set1_ps(hi);
+    size_t i = 0;
+    for(; i + 4 <= count; i += 4){
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(data + i), s);
+        _mm_storeu_ps(data + i, _mm_min_ps(_mm_max_ps(v, l), h));
+    }
+    scaleClampScalar(data, i, count, scale, lo, hi);
+}
+#endif
+
+/**
+ * Multiplies every element of an array and clamps it to a range, like the evaporation step of
+ * an ant colony
+ * @param data is the array to change
+ * @param count is the number of elements
+ * @param scale multiplies every element
+ * @param lo is the smallest value kept
+ * @param hi is the largest value kept
+ * @param level is the kernel to use, defaults to the widest the cpu supports
+ */
+inline void scaleClamp(float* data, size_t count, float scale, float lo, float hi, simd_Type level = simdLevel()) {
+#ifdef TSP_X86_KERNELS
+    if(level == simd_avx2) {
+        scaleClampAvx2(data, count, scale, lo, hi);
+        return;
+    }
+    if(level == simd_sse41) {
+        scaleClampSse41(data, count, scale, lo, hi);
+        return;
+    }
+#endif
+    scaleClampScalar(data, 0, count, scale, lo, hi);
+}
+
+/**
+ * Scalar masked min of sums, the reference every vector version matches
+ * @param a is the first array
+ * @param b is the second array
+ * @param mask has a bit set for every index to look at
+ * @param begin is the first index to look at
+ * @param n is the number of elements
+ * @param best is the smallest sum so far, updated
+ */
+inline void minSumScalar(const int32_t* a, const int32_t* b, uint32_t mask, uint32_t begin, uint32_t n, int32_t& best) {
+    for(uint32_t i = begin; i < n; i++){
+        if((mask >> i) & 1) {
+            int32_t sum = a[i] + b[i];
+            best = sum < best ? sum : best;
+        }
+    }
+}
+
+#ifdef TSP_X86_KERNELS
+/**
+ * AVX2 masked min of sums, 8 sums at a time with the unselected lanes blocked out
+ */
+__attribute__((target("avx2")))
+inline int32_t minSumAvx2(const int32_t* a, const int32_t* b, uint32_t mask, uint32_t n) {
+    const __m256i blocked = _mm256_set1_epi32(numeric_limits<int32_t>::max());
+    __m256i best = blocked;
+    uint32_t i = 0;
+    for(; i + 8 <= n; i += 8){
+        __m256i sum = _mm256_add_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i)),
+                                       _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i)));
+        sum = _mm256_blendv_epi8(blocked, sum, visitedLanes8((mask >> i) & 0xFF));
+        best = _mm256_min_epi32(best, sum);
+    }
+    __m128i half = _mm_min_epi32(_mm256_castsi256_si128(best), _mm256_extracti128_si256(best, 1));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+    half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t result = _mm_cvtsi128_si32(half);
+    minSumScalar(a, b, mask, i, n, result);
+    return result;
+}
+
+/**
+ * SSE4.1 masked min of sums, 4 sums at a time
+ */
+__attribute__((target("sse4.1")))
+inline int32_t minSumSse41(const int32_t* a, const int32_t* b, uint32_t mask, uint32_t n) {
+    const __m128i blocked = _mm_set1_epi32(numeric_limits<int32_t>::max());
+    __m128i best = blocked;
+    uint32_t i = 0;
+    for(; i + 4 <= n; i += 4){
+        __m128i sum = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+                                    _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        sum = _mm_blendv_epi8(blocked, sum, visitedLanes4((mask >> i) & 0xF));
+        best = _mm_min_epi32(best, sum);
+    }
+    best = _mm_min_epi32(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(1, 0, 3, 2)));
+    best = _mm_min_epi32(best, _mm_shuffle_epi32(best, _MM_SHUFFLE(2, 3, 0, 1)));
+    int32_t result = _mm_cvtsi128_si32(best);
+    minSumScalar(a, b, mask, i, n, result);
+    return result;
+}
+#endif
+
+/**
+ * Finds the smallest a[i] + b[i] over the indexes set in a mask, the inner step of the subset
+ * dynamic program. The sums of selected entries must not overflow, the rest are never added
+ * by the scalar version and are blocked out of the vector ones
+ * @param a is the first array
+ * @param b is the second array
+ * @param mask has a bit set for every index to look at, so at most 32 elements
+ * @param n is the number of elements
+ * @param level is the kernel to use, defaults to the widest the cpu supports
+ * @return the smallest sum, or the largest int32_t if no bit is set
+ */
+inline int32_t maskedMinSum(const int32_t* a, const int32_t* b, uint32_t mask, uint32_t n, simd_Type level = simdLevel()) {
+#ifdef TSP_X86_KERNELS
+    if(level == simd_avx2)
+        return minSumAvx2(a, b, mask, n);
+    if(level == simd_sse41)
+        return minSumSse41(a, b, mask, n);
+#endif
+    int32_t best = numeric_limits<int32_t>::max();
+    minSumScalar(a, b, mask, 0, n, best);
+    return best;
+}
+
+#endif //TSP_KERNELS_H
@@ -0,0 +1,241 @@
+/**
+ * Lin-Kernighan style improvement
+ * Every improving move is a chain of 2-opt exchanges grown from one city: each step breaks the
+ * edge that the last step left open and adds an edge to a candidate neighbor, as long as the
+ * running gain stays positive, and the chain is kept as soon as closing it shortens the tour.
+ * With the default depth of 4 that reaches sequential 5-opt moves. When the tour is locally
+ * optimal it is kicked with a double bridge on a short stretch of the tour and searched again,
+ * keeping the result only if it is no longer than the best tour so far
+ */
+
+#ifndef TSP_LK_H
+#define TSP_LK_H
+
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "LocalSearch.h"
+
+using namespace std;
+
+template <typename T, typename TourType = ArrayTour>
+class LK : public LocalSearch<T, TourType>{
+public:
+    explicit LK(Graph<T>& gr) : LocalSearch<T, TourType>(gr) {}
+    vector<T> optimize(const vector<T>& path);
+    void setBudget(uint32_t kicks, double seconds) {maxKicks = kicks; maxSeconds = seconds;}
+    void setDepth(uint32_t depth) {maxDepth = depth;}
+    void setSeed(uint32_t value) {seed = value;}
+    uint32_t getKicks() const {return kicks;}
+protected:
+    struct exchange{uint32_t a, b, c, d;};  // the arguments of one make2opt call
+    vector<exchange> log;       // exchanges since the last kick, so they can be undone
+    vector<exchange> chain;     // exchanges of the move being built
+    vector<uint32_t> touched;   // cities whose edges the move being built changed
+    uint32_t maxKicks = 0;      // 0 runs one kick per city
+    double maxSeconds = 0;      // 0 has no time limit
+    uint32_t maxDepth = 4;
+    uint32_t seed = 1;
+    uint32_t kicks = 0;
+    void make2opt(TourType& tour, uint32_t a, uint32_t b, uint32_t c, uint32_t d);
+    long long localSearch(TourType& tour);
+    bool improveFrom(TourType& tour, uint32_t t1, long long& gain);
+    bool step(TourType& tour, uint32_t t1, uint32_t t2, long long gain, uint32_t depth, long long& closed);
+    long long doubleBridge(TourType& tour, mt19937& rng);
+};
+
+/**
+ * Improves a tour until the kick or time budget runs out
+ * @tparam T is the type of the graph
+ * @tparam TourType is ArrayTour, or TwoLevelTour for large tours
+ * @param path is a closed tour to start from, like the one returned by getPath
+ * @return the best tour found, or the same one if it doesn't visit every node exactly once
+ */
+template <typename T, typename TourType>
+vector<T> LK<T, TourType>::optimize(const vector<T>& path) {
+    vector<uint32_t> order;
+    kicks = 0;
+    if(!this->toIds(path, order))
+        return path;
+    auto start = chrono::steady_clock::now();
+    uint32_t n = static_cast<uint32_t>(order.size());
+    uint32_t budget = maxKicks == 0 ? n : maxKicks;
+    mt19937 rng(seed);
+    TourType tour(order);
+    this->resetQueue(order);
+    log.clear();
+    localSearch(tour);
+    while(kicks < budget && n >= 8){
+        if(maxSeconds > 0 && chrono::duration<double>(chrono::steady_clock::now() - start).count() >= maxSeconds)
+            break;
+        kicks++;
+        log.clear();
+        long long change = doubleBridge(tour, rng);
+        change -= localSearch(tour);
+        if(change > 0) {    // worse than before the kick, so every exchange since then is undone
+            for(size_t i = log.size(); i-- > 0;)
+                make2opt(tour, log[i].a, log[i].c, log[i].b, log[i].d);
+        }
+    }
+    return this->toPath(tour.getOrder());
+}
+
+/**
+ * Removes the edges (a, b) and (c, d) and adds (a, c) and (b, d). b must follow a and d must
+ * follow c in the same direction. Calling it again with b and c swapped undoes it
+ * @tparam T is the type of the graph
+ * @param tour is the tour to change
+ */
+template <typename T, typename TourType>
+void LK<T, TourType>::make2opt(TourType& tour, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+    if(tour.next(a) == b)
+        tour.flip(b, c);
+    else
+        tour.flip(a, d);
+}
+
+/**
+ * Applies improving moves until every city's don't-look bit is on
+ * @tparam T is the type of the graph
+ * @param tour is the tour to improve
+ * @return how much shorter the tour got
+ */
+template <typename T, typename TourType>
+long long LK<T, TourType>::localSearch(TourType& tour) {
+    long long total = 0;
+    while(!this->active.empty()){
+        uint32_t t1 = this->active.front();
+        this->active.pop_front();
+        this->dontLook[t1] = 1;
+        long long gain = 0;
+        if(improveFrom(tour, t1, gain)) {
+            total += gain;
+            this->wake(t1);
+            for(unsigned int i = 0; i < touched.size(); i++)
+                this->wake(touched[i]);
+        }
+    }
+    return total;
+}
+
+/**
+ * Tries to grow an improving move from both tour edges of a city
+ * @tparam T is the type of the graph
+ * @param tour is the tour to improve
+ * @param t1 is the city the move starts from
+ * @param gain is set to how much shorter the tour got
+ * @return true if the tour was changed
+ */
+template <typename T, typename TourType>
+bool LK<T, TourType>::improveFrom(TourType& tour, uint32_t t1, long long& gain) {
+    for(int dir = 0; dir < 2; dir++){
+        uint32_t t2 = dir == 0 ? tour.next(t1) : tour.prev(t1);
+        chain.clear();
+        touched.clear();
+        if(step(tour, t1, t2, this->dist(t1, t2), 0, gain)) {
+            log.insert(log.end(), chain.begin(), chain.end());
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Extends the move by one exchange. The edge (t1, t2) is open, t2 is joined to a candidate t3,
+ * and t3's neighbor t4 on the far side is cut loose so (t4, t1) closes the tour. The first
+ * steps try the few best candidates, measured by what the step gains before closing, deeper
+ * steps only the best one
+ * @tparam T is the type of the graph
+ * @param tour is the tour to improve
+ * @param t1 is the city the move started from
+ * @param t2 is the open end
+ * @param gain is the weight removed so far minus the weight added, not counting a closing edge
+ * @param depth is the number of exchanges already in the move
+ * @param closed is set to how much shorter the tour got if the move was kept
+ * @return true if an improving move was found and kept
+ */
+template <typename T, typename TourType>
+bool LK<T, TourType>::step(TourType& tour, uint32_t t1, uint32_t t2, long long gain, uint32_t depth, long long& closed) {
+    static const uint32_t BREADTH[] = {5, 3};
+    uint32_t breadth = depth < 2 ? BREADTH[depth] : 1;
+    bool forward = tour.next(t1) == t2;
+    const uint32_t* near = this->cand.get(t2);
+    vector<pair<long long, uint32_t>> options;
+    for(uint32_t i = 0; i < this->cand.count(t2); i++){
+        uint32_t t3 = near[i];
+        long long g1 = gain - this->dist(t2, t3);
+        if(g1 <= 0)     // the lists are sorted, so no later candidate keeps a positive gain
+            break;
+        uint32_t t4 = forward ? tour.prev(t3) : tour.next(t3);
+        if(t3 == t1 || t4 == t2)
+            continue;
+        bool added = false;     // edges added by this move are never broken again
+        for(unsigned int j = 0; j < chain.size() && !added; j++)
+            added = (chain[j].b == t3 && chain[j].d == t4) || (chain[j].b == t4 && chain[j].d == t3);
+        if(!added)
+            options.push_back(pair<long long, uint32_t>(-(g1 + this->dist(t3, t4)), t3));
+    }
+    sort(options.begin(), options.end());
+    for(unsigned int i = 0; i < options.size() && i < breadth; i++){
+        // undoing a failed option can leave the tour running the other way
+        forward = tour.next(t1) == t2;
+        uint32_t t3 = options[i].second;
+        uint32_t t4 = forward ? tour.prev(t3) : tour.next(t3);
+        long long open = -options[i].first;   // gain with (t1, t4) still open
+        exchange ex = {t1, t2, t4, t3};
+        make2opt(tour, t1, t2, t4, t3);
+        chain.push_back(ex);
+        if(open - this->dist(t4, t1) > 0) {
+            closed = open - this->dist(t4, t1);
+            for(unsigned int j = 0; j < chain.size(); j++){
+                touched.push_back(chain[j].b);
+                touched.push_back(chain[j].c);
+                touched.push_back(chain[j].d);
+            }
+            return true;
+        }
+        if(depth + 1 < maxDepth && step(tour, t1, t4, open, depth + 1, closed))
+            return true;
+        chain.pop_back();
+        make2opt(tour, t1, t4, t2, t3);
+    }
+    return false;
+}
+
+/**
+ * Kicks the tour with a double bridge that swaps two short consecutive segments after a random
+ * city, a1 b1..b2 c1..c2 d1 becomes a1 c1..c2 b1..b2 d1. Only the six cities at the ends of the
+ * three changed edges are woken
+ * @tparam T is the type of the graph
+ * @param tour is the tour to change
+ * @param rng picks the city and the segment lengths
+ * @return how much longer the tour got
+ */
+template <typename T, typename TourType>
+long long LK<T, TourType>::doubleBridge(TourType& tour, mt19937& rng) {
+    uint32_t n = tour.size();
+    uint32_t span = max<uint32_t>(1, min<uint32_t>(50, (n - 2) / 3));
+    uint32_t a1 = rng() % n;
+    uint32_t b1 = tour.next(a1), b2 = b1;
+    for(uint32_t i = rng() % span; i > 0; i--)
+        b2 = tour.next(b2);
+    uint32_t c1 = tour.next(b2), c2 = c1;
+    for(uint32_t i = rng() % span; i > 0; i--)
+        c2 = tour.next(c2);
+    uint32_t d1 = tour.next(c2);
+    long long change = this->dist(a1, c1) + this->dist(c2, b1) + this->dist(b2, d1)
+                       - this->dist(a1, b1) - this->dist(b2, c1) - this->dist(c2, d1);
+    // three reversals, each one a 2-opt exchange
+    exchange steps[3] = {{a1, b1, c2, d1}, {a1, c2, c1, b2}, {c2, b2, b1, d1}};
+    for(int i = 0; i < 3; i++){
+        make2opt(tour, steps[i].a, steps[i].b, steps[i].c, steps[i].d);
+        log.push_back(steps[i]);
+    }
+    uint32_t ends[] = {a1, b1, b2, c1, c2, d1};
+    for(int i = 0; i < 6; i++)
+        this->wake(ends[i]);
+    return change;
+}
+
+#endif //TSP_LK_H
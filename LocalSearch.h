@@ -0,0 +1,301 @@
+/**
+ * Improves a finished tour with local search
+ * Moves are only tried between a city and its nearest neighbors, and a city whose
+ * neighborhood had no improving move is skipped until one of its tour edges changes
+ * (don't-look bits), so a pass costs about O(n k) instead of O(n^2)
+ */
+
+#ifndef TSP_LOCALSEARCH_H
+#define TSP_LOCALSEARCH_H
+
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include <climits>
+#include <iostream>
+#include "Graph.h"
+#include "Candidates.h"
+#include "Tour.h"
+
+using namespace std;
+
+template <typename T, typename TourType = ArrayTour>
+class LocalSearch{
+public:
+    explicit LocalSearch(Graph<T>& gr) : graph(gr) {}
+    void setNeighbors(uint32_t k) {neighbors = k; cand.clear();}
+    void setCandidates(const CandidateSet& set) {cand = set; neighbors = set.getK();}
+    void setThreads(unsigned count) {threads = count;}
+    vector<T> twoOpt(const vector<T>& path) {return run(path, true, false);}
+    vector<T> orOpt(const vector<T>& path) {return run(path, false, true);}
+    vector<T> improve(const vector<T>& path) {return run(path, true, true);}
+protected:
+    Graph<T>& graph;
+    CandidateSet cand;
+    uint32_t neighbors = 8;     // length of every candidate list
+    unsigned threads = 0;       // 0 uses every hardware thread
+    vector<char> dontLook;
+    deque<uint32_t> active;     // cities whose don't-look bit is off, in the order they are checked
+    bool toIds(const vector<T>& path, vector<uint32_t>& order);
+    vector<T> toPath(const vector<uint32_t>& order) const;
+    long long dist(uint32_t from, uint32_t to) const;
+    void resetQueue(const vector<uint32_t>& order);
+    void wake(uint32_t city);
+    vector<T> run(const vector<T>& path, bool useTwoOpt, bool useOrOpt);
+    bool twoOptMove(TourType& tour, uint32_t a);
+    bool orOptMove(TourType& tour, uint32_t a);
+    bool orOptSegment(TourType& tour, uint32_t s1, uint32_t s2);
+    void moveSegment(TourType& tour, uint32_t s1, uint32_t s2, uint32_t u, bool forward);
+};
+
+/**
+ * Runs the chosen moves until none of them between a city and one of its candidates shortens
+ * the tour. With both moves every city tries 2-opt first and Or-opt if that found nothing
+ * @tparam T is the type of the graph
+ * @tparam TourType is ArrayTour, or TwoLevelTour for large tours
+ * @param path is a closed tour, like the one returned by getPath
+ * @param useTwoOpt is true to try 2-opt moves
+ * @param useOrOpt is true to try Or-opt moves
+ * @return the improved tour, or the same one if it doesn't visit every node exactly once
+ */
+template <typename T, typename TourType>
+vector<T> LocalSearch<T, TourType>::run(const vector<T>& path, bool useTwoOpt, bool useOrOpt) {
+    vector<uint32_t> order;
+    if(!toIds(path, order))
+        return path;
+    TourType tour(order);
+    resetQueue(order);
+    while(!active.empty()){
+        uint32_t a = active.front();
+        active.pop_front();
+        dontLook[a] = 1;
+        if((useTwoOpt && twoOptMove(tour, a)) || (useOrOpt && orOptMove(tour, a)))
+            wake(a);
+    }
+    return toPath(tour.getOrder());
+}
+
+/**
+ * Looks for an improving 2-opt move that removes one of the two tour edges at a city and
+ * connects it to one of its candidates, and applies the first one found
+ * @tparam T is the type of the graph
+ * @param tour is the tour to improve
+ * @param a is the city to look at
+ * @return true if the tour was changed
+ */
+template <typename T, typename TourType>
+bool LocalSearch<T, TourType>::twoOptMove(TourType& tour, uint32_t a) {
+    const uint32_t* near = cand.get(a);
+    for(int dir = 0; dir < 2; dir++){
+        // removes (a, b) and (c, d) where b and d follow a and c in the same direction
+        uint32_t b = dir == 0 ? tour.next(a) : tour.prev(a);
+        long long ab = dist(a, b);
+        for(uint32_t i = 0; i < cand.count(a); i++){
+            uint32_t c = near[i];
+            long long ac = dist(a, c);
+            if(ac >= ab)    // the lists are sorted, so no later candidate can gain either
+                break;
+            uint32_t d = dir == 0 ? tour.next(c) : tour.prev(c);
+            if(c == b || d == a)
+                continue;
+            if(ac + dist(b, d) < ab + dist(c, d)) {
+                if(dir == 0)
+                    tour.flip(b, c);
+                else
+                    tour.flip(a, d);
+                wake(b);
+                wake(c);
+                wake(d);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Looks for an improving Or-opt move that takes a segment of 1 to 3 cities starting or ending
+ * at a city and puts it between two neighboring cities elsewhere in the tour, either way
+ * around, and applies the first one found
+ * @tparam T is the type of the graph
+ * @param tour is the tour to improve
+ * @param a is the city to look at
+ * @return true if the tour was changed
+ */
+template <typename T, typename TourType>
+bool LocalSearch<T, TourType>::orOptMove(TourType& tour, uint32_t a) {
+    if(tour.size() < 8)
+        return false;
+    uint32_t last = a, first = a;
+    for(int len = 1; len <= 3; len++){
+        if(orOptSegment(tour, a, last) || (len > 1 && orOptSegment(tour, first, a)))
+            return true;
+        last = tour.next(last);
+        first = tour.prev(first);
+    }
+    return false;
+}
+
+/**
+ * Tries to move one segment next to a candidate of either of its ends. Every move is priced
+ * in O(1) from the three edges removed and the three added
+ * @tparam T is the type of the graph
+ * @param tour is the tour to improve
+ * @param s1 is the first city of the segment
+ * @param s2 is the last city of the segment, going forward from s1
+ * @return true if the segment was moved
+ */
+template <typename T, typename TourType>
+bool LocalSearch<T, TourType>::orOptSegment(TourType& tour, uint32_t s1, uint32_t s2) {
+    uint32_t p = tour.prev(s1), nx = tour.next(s2);
+    long long removed = dist(p, s1) + dist(s2, nx) - dist(p, nx);
+    if(removed <= 0)
+        return false;
+    for(int end = 0; end < 2; end++){
+        uint32_t s = end == 0 ? s1 : s2;
+        uint32_t other = end == 0 ? s2 : s1;
+        const uint32_t* near = cand.get(s);
+        for(uint32_t i = 0; i < cand.count(s); i++){
+            uint32_t c = near[i];
+            if(dist(s, c) >= removed)   // the lists are sorted, so no later candidate can gain either
+                break;
+            if(tour.between(s1, c, s2))
+                continue;
+            for(int side = 0; side < 2; side++){
+                // the segment goes between u and v, where v follows u
+                uint32_t u = side == 0 ? c : tour.prev(c);
+                uint32_t v = side == 0 ? tour.next(c) : c;
+                if(tour.between(s1, u, s2) || tour.between(s1, v, s2))
+                    continue;
+                uint32_t nearU = side == 0 ? s : other;
+                uint32_t nearV = side == 0 ? other : s;
+                long long added = dist(u, nearU) + dist(nearV, v) - dist(u, v);
+                if(added < removed) {
+                    moveSegment(tour, s1, s2, u, nearU == s1);
+                    wake(p);
+                    wake(nx);
+                    wake(s1);
+                    wake(s2);
+                    wake(u);
+                    wake(v);
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Moves a segment between a city and the city after it with reversals, so it works on any
+ * tour that can flip. p s1..s2 nx .. u v becomes p nx .. u s2..s1 v by reversing s1..u and
+ * then nx..u, and the segment itself is reversed last if it should go in forward
+ * @tparam T is the type of the graph
+ * @param tour is the tour to change
+ * @param s1 is the first city of the segment
+ * @param s2 is the last city of the segment, going forward from s1
+ * @param u is the city the segment goes after, it must not be in the segment
+ * @param forward is true if s1 should end up next to u
+ */
+template <typename T, typename TourType>
+void LocalSearch<T, TourType>::moveSegment(TourType& tour, uint32_t s1, uint32_t s2, uint32_t u, bool forward) {
+    uint32_t p = tour.prev(s1), nx = tour.next(s2);
+    // a flip can turn the whole tour around, so the direction is checked before every step
+    tour.flip(s1, u);
+    if(tour.next(p) == u)
+        tour.flip(u, nx);
+    else
+        tour.flip(nx, u);
+    if(forward) {
+        if(tour.next(u) == s2)
+            tour.flip(s2, s1);
+        else
+            tour.flip(s1, s2);
+    }
+}
+
+/**
+ * Maps a closed path onto ids and builds the candidate lists if they are missing
+ * @tparam T is the type of the graph
+ * @param path is a closed tour
+ * @param order is filled with the ids of the tour, without returning to the start
+ * @return false if the path doesn't visit every node exactly once
+ */
+template <typename T, typename TourType>
+bool LocalSearch<T, TourType>::toIds(const vector<T>& path, vector<uint32_t>& order) {
+    uint32_t n = graph.getNumNodes();
+    order.clear();
+    if(path.size() != static_cast<size_t>(n) + 1 || n < 4) {
+        if(n >= 4)
+            cout << "Tour doesn't visit every node once, not improving it" << endl;
+        return false;
+    }
+    vector<char> seen(n, 0);
+    for(uint32_t i = 0; i < n; i++){
+        uint32_t id = graph.getId(path[i]);
+        if(id == NO_ID || seen[id]) {
+            cout << "Tour doesn't visit every node once, not improving it" << endl;
+            return false;
+        }
+        seen[id] = 1;
+        order.push_back(id);
+    }
+    if(cand.isEmpty() || cand.getNumNodes() != n)
+        cand.build(graph, neighbors, threads);
+    return true;
+}
+
+/**
+ * Turns ids back into a closed path
+ * @tparam T is the type of the graph
+ * @param order is the ids of the tour, without returning to the start
+ * @return the labels of the tour, ending back at the start
+ */
+template <typename T, typename TourType>
+vector<T> LocalSearch<T, TourType>::toPath(const vector<uint32_t>& order) const {
+    vector<T> path;
+    path.reserve(order.size() + 1);
+    for(unsigned int i = 0; i < order.size(); i++)
+        path.push_back(graph.getLabel(order[i]));
+    path.push_back(graph.getLabel(order[0]));
+    return path;
+}
+
+/**
+ * Weight of the edge between two cities, a missing edge costs more than any real one
+ * @tparam T is the type of the graph
+ * @param from is the id of one end of the edge
+ * @param to is the id of the other end of the edge
+ * @return the weight of the edge
+ */
+template <typename T, typename TourType>
+long long LocalSearch<T, TourType>::dist(uint32_t from, uint32_t to) const {
+    int weight = graph.getWeight(from, to);
+    return weight == -1 ? INT_MAX : weight;
+}
+
+/**
+ * Turns every don't-look bit off and queues the cities in tour order
+ * @tparam T is the type of the graph
+ * @param order is the ids of the tour
+ */
+template <typename T, typename TourType>
+void LocalSearch<T, TourType>::resetQueue(const vector<uint32_t>& order) {
+    dontLook.assign(order.size(), 0);
+    active.assign(order.begin(), order.end());
+}
+
+/**
+ * Turns a city's don't-look bit off, queueing it if it was on
+ * @tparam T is the type of the graph
+ * @param city is the id of the city
+ */
+template <typename T, typename TourType>
+void LocalSearch<T, TourType>::wake(uint32_t city) {
+    if(dontLook[city]) {
+        dontLook[city] = 0;
+        active.push_back(city);
+    }
+}
+
+#endif //TSP_LOCALSEARCH_H
@@ -0,0 +1,519 @@
+/**
+ * Minimum weight perfect matching for the odd degree vertices in Christofides
+ * Small sets are matched exactly with Edmonds' blossom algorithm using dual variables, large
+ * sets greedily pair every vertex with its nearest free partner and then swap partners
+ * between pairs while that lowers the total weight
+ */
+
+#ifndef TSP_MATCHING_H
+#define TSP_MATCHING_H
+
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include "various.h"
+
+using namespace std;
+
+/**
+ * O(n^3) maximum weight matching on a general graph. Vertices are numbered from 1 and
+ * blossoms from n + 1, a weight of 0 means there is no edge
+ */
+class Blossom{
+public:
+    explicit Blossom(int size);
+    void setWeight(int u, int v, long long w);
+    long long solve();
+    int getMate(int u) const {return match[u + 1] == 0 ? -1 : match[u + 1] - 1;}
+private:
+    struct bEdge{
+        int u;
+        int v;
+        long long w;
+    };
+    int n;
+    int nx;     // highest vertex or blossom id in use
+    int stamp;  // marker for lca searches
+    vector<vector<bEdge>> g;
+    vector<long long> lab;  // dual variables
+    vector<int> match;
+    vector<int> slack;
+    vector<int> st;     // outermost blossom containing each vertex or blossom
+    vector<int> pa;
+    vector<vector<int>> flowerFrom;
+    vector<int> S;      // -1 unlabeled, 0 outer, 1 inner
+    vector<int> vis;
+    vector<vector<int>> flower;
+    queue<int> q;
+    long long dist(const bEdge& e) const {return lab[e.u] + lab[e.v] - e.w * 2;}
+    void updateSlack(int u, int x);
+    void setSlack(int x);
+    void qPush(int x);
+    void setSt(int x, int b);
+    int getPr(int b, int xr);
+    void setMatch(int u, int v);
+    void augment(int u, int v);
+    int getLca(int u, int v);
+    void addBlossom(int u, int lca, int v);
+    void expandBlossom(int b);
+    bool onFoundEdge(const bEdge& e);
+    bool matching();
+};
+
+/**
+ * Makes an empty graph
+ * @param size is the number of vertices
+ */
+inline Blossom::Blossom(int size) : n(size), nx(size), stamp(0), g(2 * size + 1, vector<bEdge>(2 * size + 1)),
+        lab(2 * size + 1), match(2 * size + 1), slack(2 * size + 1), st(2 * size + 1), pa(2 * size + 1),
+        flowerFrom(2 * size + 1, vector<int>(size + 1)), S(2 * size + 1), vis(2 * size + 1), flower(2 * size + 1) {
+    for(int u = 1; u <= n; u++)
+        for(int v = 1; v <= n; v++){
+            g[u][v].u = u;
+            g[u][v].v = v;
+            g[u][v].w = 0;
+        }
+}
+
+/**
+ * Sets the weight of an edge
+ * @param u is one end, numbered from 0
+ * @param v is the other end, numbered from 0
+ * @param w is a positive weight
+ */
+inline void Blossom::setWeight(int u, int v, long long w) {
+    g[u + 1][v + 1].w = w;
+    g[v + 1][u + 1].w = w;
+}
+
+inline void Blossom::updateSlack(int u, int x) {
+    if(!slack[x] || dist(g[u][x]) < dist(g[slack[x]][x]))
+        slack[x] = u;
+}
+
+inline void Blossom::setSlack(int x) {
+    slack[x] = 0;
+    for(int u = 1; u <= n; u++)
+        if(g[u][x].w > 0 && st[u] != x && S[st[u]] == 0)
+            updateSlack(u, x);
+}
+
+inline void Blossom::qPush(int x) {
+    if(x <= n)
+        q.push(x);
+    else
+        for(unsigned int i = 0; i < flower[x].size(); i++)
+            qPush(flower[x][i]);
+}
+
+inline void Blossom::setSt(int x, int b) {
+    st[x] = b;
+    if(x > n)
+        for(unsigned int i = 0; i < flower[x].size(); i++)
+            setSt(flower[x][i], b);
+}
+
+/**
+ * Finds the position of a sub blossom in its parent, flipping the cycle so the position is even
+ */
+inline int Blossom::getPr(int b, int xr) {
+    int pr = static_cast<int>(find(flower[b].begin(), flower[b].end(), xr) - flower[b].begin());
+    if(pr % 2 == 1){
+        reverse(flower[b].begin() + 1, flower[b].end());
+        return static_cast<int>(flower[b].size()) - pr;
+    }
+    return pr;
+}
+
+inline void Blossom::setMatch(int u, int v) {
+    match[u] = g[u][v].v;
+    if(u > n){
+        bEdge e = g[u][v];
+        int xr = flowerFrom[u][e.u];
+        int pr = getPr(u, xr);
+        for(int i = 0; i < pr; i++)
+            setMatch(flower[u][i], flower[u][i ^ 1]);
+        setMatch(xr, v);
+        rotate(flower[u].begin(), flower[u].begin() + pr, flower[u].end());
+    }
+}
+
+/**
+ * Flips the matched and unmatched edges along the path from u back to its root
+ */
+inline void Blossom::augment(int u, int v) {
+    while(true){
+        int xnv = st[match[u]];
+        setMatch(u, v);
+        if(!xnv)
+            return;
+        setMatch(xnv, st[pa[xnv]]);
+        u = st[pa[xnv]];
+        v = xnv;
+    }
+}
+
+inline int Blossom::getLca(int u, int v) {
+    for(++stamp; u || v; swap(u, v)){
+        if(u == 0)
+            continue;
+        if(vis[u] == stamp)
+            return u;
+        vis[u] = stamp;
+        u = st[match[u]];
+        if(u)
+            u = st[pa[u]];
+    }
+    return 0;
+}
+
+/**
+ * Shrinks the odd cycle through u, v and their lowest common ancestor into a new blossom
+ */
+inline void Blossom::addBlossom(int u, int lca, int v) {
+    int b = n + 1;
+    while(b <= nx && st[b])
+        b++;
+    if(b > nx)
+        nx++;
+    lab[b] = 0;
+    S[b] = 0;
+    match[b] = match[lca];
+    flower[b].clear();
+    flower[b].push_back(lca);
+    for(int x = u, y; x != lca; x = st[pa[y]]){
+        flower[b].push_back(x);
+        flower[b].push_back(y = st[match[x]]);
+        qPush(y);
+    }
+    reverse(flower[b].begin() + 1, flower[b].end());
+    for(int x = v, y; x != lca; x = st[pa[y]]){
+        flower[b].push_back(x);
+        flower[b].push_back(y = st[match[x]]);
+        qPush(y);
+    }
+    setSt(b, b);
+    for(int x = 1; x <= nx; x++){
+        g[b][x].w = 0;
+        g[x][b].w = 0;
+    }
+    for(int x = 1; x <= n; x++)
+        flowerFrom[b][x] = 0;
+    for(unsigned int i = 0; i < flower[b].size(); i++){
+        int xs = flower[b][i];
+        for(int x = 1; x <= nx; x++)
+            if(g[b][x].w == 0 || dist(g[xs][x]) < dist(g[b][x])){
+                g[b][x] = g[xs][x];
+                g[x][b] = g[x][xs];
+            }
+        for(int x = 1; x <= n; x++)
+            if(flowerFrom[xs][x])
+                flowerFrom[b][x] = xs;
+    }
+    setSlack(b);
+}
+
+/**
+ * Breaks an inner blossom whose dual variable reached zero back into its sub blossoms
+ */
+inline void Blossom::expandBlossom(int b) {
+    for(unsigned int i = 0; i < flower[b].size(); i++)
+        setSt(flower[b][i], flower[b][i]);
+    int xr = flowerFrom[b][g[b][pa[b]].u];
+    int pr = getPr(b, xr);
+    for(int i = 0; i < pr; i += 2){
+        int xs = flower[b][i];
+        int xns = flower[b][i + 1];
+        pa[xs] = g[xns][xs].u;
+        S[xs] = 1;
+        S[xns] = 0;
+        slack[xs] = 0;
+        setSlack(xns);
+        qPush(xns);
+    }
+    S[xr] = 1;
+    pa[xr] = pa[b];
+    for(unsigned int i = pr + 1; i < flower[b].size(); i++){
+        int xs = flower[b][i];
+        S[xs] = -1;
+        setSlack(xs);
+    }
+    st[b] = 0;
+}
+
+/**
+ * Handles a tight edge out of an outer vertex, growing the tree, shrinking a blossom or
+ * augmenting
+ * @return true if the matching grew
+ */
+inline bool Blossom::onFoundEdge(const bEdge& e) {
+    int u = st[e.u];
+    int v = st[e.v];
+    if(S[v] == -1){
+        pa[v] = e.u;
+        S[v] = 1;
+        int nu = st[match[v]];
+        slack[v] = 0;
+        slack[nu] = 0;
+        S[nu] = 0;
+        qPush(nu);
+    }
+    else if(S[v] == 0){
+        int lca = getLca(u, v);
+        if(!lca){
+            augment(u, v);
+            augment(v, u);
+            return true;
+        }
+        addBlossom(u, lca, v);
+    }
+    return false;
+}
+
+/**
+ * Searches for one augmenting path, adjusting the duals whenever no edge is tight
+ * @return true if the matching grew
+ */
+inline bool Blossom::matching() {
+    fill(S.begin() + 1, S.begin() + nx + 1, -1);
+    fill(slack.begin() + 1, slack.begin() + nx + 1, 0);
+    q = queue<int>();
+    for(int x = 1; x <= nx; x++)
+        if(st[x] == x && !match[x]){
+            pa[x] = 0;
+            S[x] = 0;
+            qPush(x);
+        }
+    if(q.empty())
+        return false;
+    while(true){
+        while(!q.empty()){
+            int u = q.front();
+            q.pop();
+            if(S[st[u]] == 1)
+                continue;
+            for(int v = 1; v <= n; v++)
+                if(g[u][v].w > 0 && st[u] != st[v]){
+                    if(dist(g[u][v]) == 0){
+                        if(onFoundEdge(g[u][v]))
+                            return true;
+                    }
+                    else
+                        updateSlack(u, st[v]);
+                }
+        }
+        long long d = LLONG_MAX;
+        for(int b = n + 1; b <= nx; b++)
+            if(st[b] == b && S[b] == 1)
+                d = min(d, lab[b] / 2);
+        for(int x = 1; x <= nx; x++)
+            if(st[x] == x && slack[x]){
+                if(S[x] == -1)
+                    d = min(d, dist(g[slack[x]][x]));
+                else if(S[x] == 0)
+                    d = min(d, dist(g[slack[x]][x]) / 2);
+            }
+        for(int u = 1; u <= n; u++){
+            if(S[st[u]] == 0){
+                if(lab[u] <= d)
+                    return false;
+                lab[u] -= d;
+            }
+            else if(S[st[u]] == 1)
+                lab[u] += d;
+        }
+        for(int b = n + 1; b <= nx; b++)
+            if(st[b] == b){
+                if(S[st[b]] == 0)
+                    lab[b] += d * 2;
+                else if(S[st[b]] == 1)
+                    lab[b] -= d * 2;
+            }
+        q = queue<int>();
+        for(int x = 1; x <= nx; x++)
+            if(st[x] == x && slack[x] && st[slack[x]] != x && dist(g[slack[x]][x]) == 0)
+                if(onFoundEdge(g[slack[x]][x]))
+                    return true;
+        for(int b = n + 1; b <= nx; b++)
+            if(st[b] == b && S[b] == 1 && lab[b] == 0)
+                expandBlossom(b);
+    }
+}
+
+/**
+ * Finds the maximum weight matching
+ * @return the total weight of the matching
+ */
+inline long long Blossom::solve() {
+    fill(match.begin(), match.end(), 0);
+    nx = n;
+    long long total = 0;
+    for(int u = 0; u <= n; u++){
+        st[u] = u;
+        flower[u].clear();
+    }
+    long long wMax = 0;
+    for(int u = 1; u <= n; u++)
+        for(int v = 1; v <= n; v++){
+            flowerFrom[u][v] = (u == v ? u : 0);
+            wMax = max(wMax, g[u][v].w);
+        }
+    for(int u = 1; u <= n; u++)
+        lab[u] = wMax;
+    while(matching())
+        ;
+    for(int u = 1; u <= n; u++)
+        if(match[u] && match[u] < u)
+            total += g[u][match[u]].w;
+    return total;
+}
+
+/**
+ * Exact minimum weight perfect matching. The weights are flipped to big - w where big is
+ * larger than half the set times the heaviest edge, so a maximum weight matching always
+ * uses as many edges as possible and among those the lightest
+ */
+template <typename F>
+vector<pair<uint32_t, uint32_t>> blossomMatching(const vector<uint32_t>& verts, F cost) {
+    int k = static_cast<int>(verts.size());
+    vector<pair<uint32_t, uint32_t>> pairs;
+    long long lo = LLONG_MAX;
+    long long hi = LLONG_MIN;
+    vector<long long> w(static_cast<size_t>(k) * k, -1);
+    for(int i = 0; i < k; i++)
+        for(int j = i + 1; j < k; j++){
+            int c = cost(verts[i], verts[j]);
+            if(c == -1)
+                continue;
+            w[static_cast<size_t>(i) * k + j] = c;
+            lo = min(lo, static_cast<long long>(c));
+            hi = max(hi, static_cast<long long>(c));
+        }
+    if(lo == LLONG_MAX)
+        return pairs;
+    long long big = (k / 2 + 1) * (hi - lo + 1) + 1;
+    Blossom b(k);
+    for(int i = 0; i < k; i++)
+        for(int j = i + 1; j < k; j++)
+            if(w[static_cast<size_t>(i) * k + j] != -1)
+                b.setWeight(i, j, big - (w[static_cast<size_t>(i) * k + j] - lo));
+    b.solve();
+    for(int i = 0; i < k; i++)
+        if(b.getMate(i) > i)
+            pairs.push_back(make_pair(verts[i], verts[b.getMate(i)]));
+    return pairs;
+}
+
+/**
+ * Heuristic matching for large sets. Every free vertex takes its nearest free partner, then
+ * pairs (a, b) and (c, d) are rewired to (a, c) and (b, d) or (a, d) and (b, c), an augmenting
+ * cycle of length four, whenever that is cheaper, trying c among the nearest few partners of a
+ */
+template <typename F>
+vector<pair<uint32_t, uint32_t>> greedyMatching(const vector<uint32_t>& verts, F cost) {
+    const uint32_t NEAR = 8;
+    uint32_t k = static_cast<uint32_t>(verts.size());
+    vector<uint32_t> mate(k, NO_ID);
+    // each vertex's nearest partners by position in verts, nearest first
+    vector<vector<uint32_t>> nearest(k);
+    for(uint32_t i = 0; i < k; i++){
+        vector<pair<int, uint32_t>> cand;
+        for(uint32_t j = 0; j < k; j++){
+            int c = j == i ? -1 : cost(verts[i], verts[j]);
+            if(c == -1)
+                continue;
+            cand.push_back(make_pair(c, j));
+            if(cand.size() > 4 * NEAR){   // keep the buffer small
+                nth_element(cand.begin(), cand.begin() + NEAR, cand.end());
+                cand.resize(NEAR);
+            }
+        }
+        sort(cand.begin(), cand.end());
+        for(uint32_t c = 0; c < cand.size() && c < NEAR; c++)
+            nearest[i].push_back(cand[c].second);
+    }
+    // greedy: the nearest free partner, scanning everything once the short list runs out
+    for(uint32_t i = 0; i < k; i++){
+        if(mate[i] != NO_ID)
+            continue;
+        uint32_t best = NO_ID;
+        for(uint32_t c = 0; c < nearest[i].size() && best == NO_ID; c++)
+            if(mate[nearest[i][c]] == NO_ID)
+                best = nearest[i][c];
+        if(best == NO_ID){
+            int bestCost = INT_MAX;
+            for(uint32_t j = 0; j < k; j++){
+                int c = (j == i || mate[j] != NO_ID) ? -1 : cost(verts[i], verts[j]);
+                if(c != -1 && c < bestCost){
+                    bestCost = c;
+                    best = j;
+                }
+            }
+        }
+        if(best != NO_ID){
+            mate[i] = best;
+            mate[best] = i;
+        }
+    }
+    // a missing edge costs more than any real one
+    auto weight = [&](uint32_t a, uint32_t b) {
+        int c = cost(verts[a], verts[b]);
+        return c == -1 ? LLONG_MAX / 4 : static_cast<long long>(c);
+    };
+    bool improved = true;
+    for(int pass = 0; improved && pass < 50; pass++){
+        improved = false;
+        for(uint32_t a = 0; a < k; a++){
+            uint32_t b = mate[a];
+            if(b == NO_ID)
+                continue;
+            for(uint32_t n = 0; n < nearest[a].size(); n++){
+                uint32_t c = nearest[a][n];
+                uint32_t d = mate[c];
+                if(c == b || d == NO_ID)
+                    continue;
+                long long now = weight(a, b) + weight(c, d);
+                if(weight(a, c) + weight(b, d) < now){
+                    mate[a] = c;
+                    mate[c] = a;
+                    mate[b] = d;
+                    mate[d] = b;
+                    improved = true;
+                    break;
+                }
+                if(weight(a, d) + weight(b, c) < now){
+                    mate[a] = d;
+                    mate[d] = a;
+                    mate[b] = c;
+                    mate[c] = b;
+                    improved = true;
+                    break;
+                }
+            }
+        }
+    }
+    vector<pair<uint32_t, uint32_t>> pairs;
+    for(uint32_t i = 0; i < k; i++)
+        if(mate[i] != NO_ID && mate[i] > i)
+            pairs.push_back(make_pair(verts[i], verts[mate[i]]));
+    return pairs;
+}
+
+/**
+ * Pairs up an even set of vertices so the total weight of the pairs is as small as possible
+ * @tparam F is called as cost(a, b) and returns the weight between two ids, -1 if there is no edge
+ * @param verts is the ids to match
+ * @param cost gives the weight of a pair
+ * @param exactLimit is the largest set that is matched exactly, larger sets use the heuristic
+ * @return the matched pairs, vertices that can't be paired are left out
+ */
+template <typename F>
+vector<pair<uint32_t, uint32_t>> minPerfectMatching(const vector<uint32_t>& verts, F cost, uint32_t exactLimit) {
+    if(verts.size() <= exactLimit)
+        return blossomMatching(verts, cost);
+    return greedyMatching(verts, cost);
+}
+
+#endif //TSP_MATCHING_H
@@ -2,26 +2,34 @@
  * Performs the nearest neighbor algorithm as the trivial solution
  * Similar to Prim's algorithm, it starts at a node and finds the shortest connection to an unvisted node
  * At the end, the path connects back to the start
+ * With more than one start the tours are built across a thread pool and the cheapest is kept
  */
 
 #ifndef TSP_NN_H
 #define TSP_NN_H
 
 #include "Graph.h"
-#include "Set.h"
 #include <vector>
 #include <cstdlib>
 #include <algorithm>
+#include <cmath>
+#include "ThreadPool.h"
+#include "Kernels.h"
 
 using namespace std;
 template <typename T>
 class NN : public Graph<T>{
 public:
     vector<T> getPath();
+    void setStarts(uint32_t count) {starts = count;}
+    const costSpread& getSpread() const {return spread;}
+    static vector<uint32_t> tourFrom(Graph<T>& graph, uint32_t start);
+protected:
+    vector<uint32_t> multiStart();
 private:
-    bool eraseInVec(T toErase, vector<T>& vec);
-    T findNextNeighbor(T cur, vector<T> toLookAt);
-    weightEdge<T> findWeights(T from, T to, vector<weightEdge<T>> vec);
+    uint32_t starts = 1;    // number of starting nodes to try, 0 for every node
+    costSpread spread;
+    static uint32_t findNextNeighbor(Graph<T>& graph, uint32_t cur, const vector<uint64_t>& visited);
 };
 
 /**
@@ -32,101 +40,130 @@ private:
 template <typename T>
 vector<T> NN<T>::getPath() {
     vector<T> path;
-    auto iter = this->nodes.begin();
-    if(iter == this->nodes.end()) {
+    if(this->getNumNodes() == 0) {
         cout << "error in graph";
+        return path;
     }
-    vector<T> toLookAt;
-    // set all nodes to unvisited
-    for(iter = this->nodes.begin(); iter != this->nodes.end(); iter++){
-        toLookAt.push_back(iter->first);
-    }
-    bool isDone = false;
-    T cur = this->nodes.begin()->first;
+    this->buildIndex();
+    if(!this->isDense())    // dense graphs are scanned straight from the matrix
+        this->buildAdjacency();
     // the path changes according to the starting node
-//    T cur = this->nodes.find("15")->first;
-    T start = cur;
-    path.push_back(cur);
-    isDone = !eraseInVec(cur, toLookAt);
-    // while there are still unvisited nodes
-    while(!isDone){
-        T nextN = findNextNeighbor(cur, toLookAt);
-        if(nextN == cur) // if there was a problem finding the next node, quit
-            break;
-        path.push_back(nextN);
-        cur = nextN;
-        eraseInVec(cur, toLookAt); // set this node to visited
-        isDone = toLookAt.size() == 0;
+    vector<uint32_t> tour;
+    if(starts == 1) {
+        tour = tourFrom(*this, 0);
+        spread.runs = 1;
+        spread.best = spread.worst = this->tourCost(tour);
+        spread.mean = static_cast<double>(spread.best);
+        spread.stdDev = 0;
     }
-    path.push_back(start); // must connect back to start
+    else
+        tour = multiStart();
+    for(unsigned int i = 0; i < tour.size(); i++)
+        path.push_back(this->labels[tour[i]]);
+    path.push_back(this->labels[tour[0]]); // must connect back to start
     return path;
 }
 
-
 /**
- * Erases an element in a vector
+ * Builds a nearest neighbor tour by id in one pass, O(n^2) on a dense graph and O(E) on a
+ * sparse one. Visited nodes are kept in a bitmap. The index and adjacency must already be
+ * built, so tours can be built from several threads at once. It only reads the graph, so other
+ * solvers can use it to build starting tours on any graph
  * @tparam T is the type of the graph
- * @param toErase is the element to erase
- * @param vec is the vector to erase an element from
- * @return false if could not erase the element
+ * @param graph is the graph to build the tour on
+ * @param start is the id of the first node
+ * @return the ids in the order they are visited, without returning to the start. The tour
+ * stops early if it reaches a node with no unvisited neighbors
  */
 template <typename T>
-bool NN<T>::eraseInVec(T toErase, vector<T>& vec) {
-    auto iter = find(vec.begin(), vec.end(), toErase);
-    if(iter == vec.end())
-        return false;
-    vec.erase(iter);
-    return true;
+vector<uint32_t> NN<T>::tourFrom(Graph<T>& graph, uint32_t start) {
+    uint32_t n = graph.getNumNodes();
+    vector<uint64_t> visited((n + 63) / 64, 0);
+    vector<uint32_t> tour;
+    tour.reserve(n);
+    uint32_t cur = start;
+    // while there are still unvisited nodes
+    while(cur != NO_ID){
+        tour.push_back(cur);
+        visited[cur >> 6] |= uint64_t(1) << (cur & 63); // set this node to visited
+        if(tour.size() == n)
+            break;
+        cur = findNextNeighbor(graph, cur, visited);
+    }
+    return tour;
 }
 
 /**
- * Finds the the shortest connecting edge from the currect node to an unvisited node
+ * Builds a tour from every start, or from starts evenly spaced ids, across the thread pool
+ * and keeps the cheapest. Tours that got stuck before visiting every node lose to complete
+ * ones, and ties go to the lowest start, so the result doesn't depend on the thread count
  * @tparam T is the type of the graph
- * @param cur is the node being looked at
- * @param toLookAt is a vector of the unvisited nodes
- * @return the name of the node that has the shortest connecting path between it and the current node
+ * @return the ids of the best tour
  */
 template <typename T>
-T NN<T>::findNextNeighbor(T cur, vector<T> toLookAt) {
-    vector<weightEdge<T>> wgts = this->weights;
-    auto iter = this->nodes.find(cur);
-    vector<T> edges = iter->second.edges;
-    vector<weightEdge<T>> options;
-    //adds all the edges between the current node and a node that's unvisited to a vector
-    for(int i = 0; i < edges.size(); i++){
-        auto fnd = find(toLookAt.begin(), toLookAt.end(), edges[i]);
-        if(fnd != toLookAt.end()) {
-            weightEdge<T> wE = findWeights(cur, edges[i], wgts);
-            options.push_back(wE);
+vector<uint32_t> NN<T>::multiStart() {
+    uint32_t n = this->getNumNodes();
+    uint32_t count = (starts == 0 || starts > n) ? n : starts;
+    vector<long long> costs(count);
+    vector<char> complete(count);
+    ThreadPool pool(this->threads);
+    pool.parallelFor(0, count, [&](size_t lo, size_t hi, unsigned) {
+        for(size_t i = lo; i < hi; i++){
+            vector<uint32_t> tour = tourFrom(*this, static_cast<uint32_t>(i * n / count));
+            costs[i] = this->tourCost(tour);
+            complete[i] = tour.size() == n;
         }
+    });
+    uint32_t best = 0;
+    double sum = 0;
+    double sumSq = 0;
+    spread.worst = costs[0];
+    for(uint32_t i = 0; i < count; i++){
+        if((complete[i] && !complete[best]) || (complete[i] == complete[best] && costs[i] < costs[best]))
+            best = i;
+        spread.worst = max(spread.worst, costs[i]);
+        sum += costs[i];
+        sumSq += static_cast<double>(costs[i]) * costs[i];
     }
-    // sorts the vector by the weight of the paths such that the shortest path is first
-    std::sort(options.begin(), options.end(), customFunc<T>());
-    if(options.size() != 0){
-        if(cur == options[0].from) //returns the value that is not the current node
-            return options[0].to;
-        return options[0].from;
-    }
+    spread.runs = count;
+    spread.best = costs[best];
+    spread.mean = sum / count;
+    spread.stdDev = sqrt(max(0.0, sumSq / count - spread.mean * spread.mean));
+    // rebuilding the winner is cheaper than keeping every tour
+    return tourFrom(*this, static_cast<uint32_t>(best * static_cast<uint64_t>(n) / count));
 }
 
-
 /**
- * Finds the pair of nodes in a specified vector of weight objects
+ * Finds the the shortest connecting edge from the currect node to an unvisited node
  * @tparam T is the type of the graph
- * @param from is the start node
- * @param to is the destination node
- * @param vec is a vector of weighted edges to find the connecting edge in
- * @return the weighted edge with the same pair of cities
+ * @param graph is the graph the tour is built on
+ * @param cur is the id of the node being looked at
+ * @param visited is a bitmap of the visited ids
+ * @return the id of the node that has the shortest connecting path between it and the current node,
+ * NO_ID if there is no unvisited neighbor
  */
 template <typename T>
-weightEdge<T> NN<T>::findWeights(T from, T to, vector<weightEdge<T>> vec) {
-    for(int i = 0; i < vec.size(); i++){
-        weightEdge<T> wE = vec[i];
-        if(wE.to == from || wE.to == to){ //undirected
-            if(wE.from == from || wE.from == to){
-                return wE;
-            }
+uint32_t NN<T>::findNextNeighbor(Graph<T>& graph, uint32_t cur, const vector<uint64_t>& visited) {
+    if(graph.isDense()){ // every node is a neighbor, so scan the node's row of the matrix
+        const DistMatrix& matrix = graph.getMatrix();
+        uint32_t n = graph.getNumNodes();
+        if(matrix.getType() == m_int16)
+            return maskedArgmin(matrix.row<int16_t>(cur), visited.data(), n);
+        if(matrix.getType() == m_float)
+            return maskedArgmin(matrix.row<float>(cur), visited.data(), n);
+        return maskedArgmin(matrix.row<int32_t>(cur), visited.data(), n);
+    }
+    const uint32_t* edges = graph.getNeighbors(cur);
+    const int* wgts = graph.getNeighborWeights(cur);
+    uint32_t best = NO_ID;
+    int bestWeight = INT_MAX;
+    // looks at all the edges between the current node and a node that's unvisited
+    for(uint32_t i = 0; i < graph.getDegree(cur); i++){
+        if(wgts[i] < bestWeight && !testBit(visited.data(), edges[i])) {
+            bestWeight = wgts[i];
+            best = edges[i];
         }
     }
+    return best;
 }
 #endif //TSP_NN_H
@@ -0,0 +1,286 @@
+/**
+ * Minimum 1-trees
+ * A 1-tree is a spanning tree over every node but a special one, plus two edges from the
+ * special node. Every tour is a 1-tree, so the lightest 1-tree can't be longer than the
+ * shortest tour and most of its edges show up in good tours. The tree is taken from a minimum
+ * spanning tree with a leaf as the special node, and edge costs can carry a penalty on each
+ * end. The alpha value of an edge is how much longer the lightest 1-tree that has to use the
+ * edge is, which ranks edges much better than their weight alone
+ */
+
+#ifndef TSP_ONETREE_H
+#define TSP_ONETREE_H
+
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include "Graph.h"
+
+using namespace std;
+
+class OneTree{
+public:
+    template <typename T>
+    void build(Graph<T>& graph, const vector<idEdge>& tree, const vector<double>& pi = vector<double>());
+    template <typename T>
+    static vector<idEdge> span(Graph<T>& graph, const vector<double>& pi);
+    template <typename T>
+    double cost(const Graph<T>& graph, uint32_t a, uint32_t b) const;
+    void beta(uint32_t from, vector<double>& longest, vector<uint32_t>& mark) const;
+    double pathMax(uint32_t a, uint32_t b) const;
+    double alpha(uint32_t a, uint32_t b, double edgeCost, double longest) const;
+    uint32_t getSpecial() const {return special;}
+    uint32_t getDegree(uint32_t node) const {return degree[node];}
+    double getLength() const {return length;}
+private:
+    uint32_t n = 0;
+    uint32_t special = NO_ID;
+    uint32_t first = NO_ID;         // the special node's neighbor in the spanning tree
+    uint32_t second = NO_ID;        // the special node's lightest edge outside the tree
+    double secondCost = 0;
+    double length = 0;              // total cost of the 1-tree, penalties included
+    vector<double> penalty;
+    vector<uint32_t> parent;        // NO_ID at the roots and the special node
+    vector<double> up;              // cost of the edge to the parent
+    vector<uint32_t> depth;
+    vector<uint32_t> order;         // every node but the special one, parents first
+    vector<uint32_t> degree;
+};
+
+/**
+ * Builds the 1-tree from a minimum spanning tree. Taking a leaf out of a minimum spanning tree
+ * leaves a minimum spanning tree of the other nodes, and the leaf's tree edge is its lightest
+ * edge, so adding its next lightest edge gives a minimum 1-tree. The leaf whose next lightest
+ * edge is the heaviest is picked, which makes the 1-tree as long as it can be
+ * @tparam T is the type of the graph
+ * @param graph is the graph the tree spans
+ * @param tree is a minimum spanning tree (or forest) under the penalized costs
+ * @param pi is the penalty on every node, empty for none
+ */
+template <typename T>
+void OneTree::build(Graph<T>& graph, const vector<idEdge>& tree, const vector<double>& pi) {
+    n = graph.getNumNodes();
+    penalty = pi;
+    penalty.resize(n, 0);
+    special = first = second = NO_ID;
+    secondCost = 0;
+    length = 0;
+    vector<uint32_t> offsets(n + 1, 0), links(2 * tree.size());
+    for(const idEdge& e : tree){
+        offsets[e.from + 1]++;
+        offsets[e.to + 1]++;
+    }
+    for(uint32_t i = 0; i < n; i++)
+        offsets[i + 1] += offsets[i];
+    vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for(const idEdge& e : tree){
+        links[fill[e.from]++] = e.to;
+        links[fill[e.to]++] = e.from;
+    }
+    degree.assign(n, 0);
+    for(uint32_t i = 0; i < n; i++)
+        degree[i] = offsets[i + 1] - offsets[i];
+    for(uint32_t leaf = 0; leaf < n; leaf++){
+        if(degree[leaf] != 1)
+            continue;
+        uint32_t treeNeighbor = links[offsets[leaf]], best = NO_ID;
+        double bestCost = numeric_limits<double>::infinity();
+        if(graph.isDense()) {
+            for(uint32_t to = 0; to < n; to++){
+                double c = cost(graph, leaf, to);
+                if(to != leaf && to != treeNeighbor && c < bestCost) {
+                    bestCost = c;
+                    best = to;
+                }
+            }
+        }
+        else {
+            const uint32_t* edges = graph.getNeighbors(leaf);
+            for(uint32_t j = 0; j < graph.getDegree(leaf); j++){
+                double c = cost(graph, leaf, edges[j]);
+                if(edges[j] != leaf && edges[j] != treeNeighbor && (c < bestCost || (c == bestCost && edges[j] < best))) {
+                    bestCost = c;
+                    best = edges[j];
+                }
+            }
+        }
+        if(best != NO_ID && (special == NO_ID || bestCost > secondCost)) {
+            special = leaf;
+            first = treeNeighbor;
+            second = best;
+            secondCost = bestCost;
+        }
+    }
+    // roots what is left of the forest, one breadth first pass per component
+    parent.assign(n, NO_ID);
+    up.assign(n, 0);
+    depth.assign(n, 0);
+    order.clear();
+    vector<bool> seen(n, false);
+    if(special != NO_ID)
+        seen[special] = true;
+    for(uint32_t root = 0; root < n; root++){
+        if(seen[root])
+            continue;
+        seen[root] = true;
+        size_t head = order.size();
+        order.push_back(root);
+        while(head < order.size()){
+            uint32_t node = order[head++];
+            for(uint32_t j = offsets[node]; j < offsets[node + 1]; j++){
+                uint32_t child = links[j];
+                if(seen[child])
+                    continue;
+                seen[child] = true;
+                parent[child] = node;
+                up[child] = cost(graph, node, child);
+                depth[child] = depth[node] + 1;
+                length += up[child];
+                order.push_back(child);
+            }
+        }
+    }
+    if(special != NO_ID) {
+        length += cost(graph, special, first) + secondCost;
+        degree[special] = 2;
+        degree[second]++;
+    }
+}
+
+/**
+ * Finds a minimum spanning tree under penalized costs, which the graph's own cached tree
+ * can't give. Dense graphs use Prim's algorithm over the rows in O(n^2), sparse ones sort
+ * their edges for Kruskal's
+ * @tparam T is the type of the graph
+ * @param graph is the graph to span
+ * @param pi is the penalty on every node
+ * @return the edges of the tree (or forest if the graph isn't connected) with their weights
+ */
+template <typename T>
+vector<idEdge> OneTree::span(Graph<T>& graph, const vector<double>& pi) {
+    graph.buildIndex();
+    uint32_t n = graph.getNumNodes();
+    vector<idEdge> tree;
+    if(n == 0)
+        return tree;
+    if(graph.isDense()) {
+        const double far = numeric_limits<double>::infinity();
+        vector<double> key(n, far);
+        vector<uint32_t> from(n, NO_ID);
+        vector<bool> done(n, false);
+        for(uint32_t added = 0; added < n; added++){
+            uint32_t next = NO_ID;
+            for(uint32_t i = 0; i < n; i++)
+                if(!done[i] && (next == NO_ID || key[i] < key[next]))
+                    next = i;
+            done[next] = true;
+            if(from[next] != NO_ID)
+                tree.push_back(idEdge{from[next], next, graph.getWeight(from[next], next)});
+            for(uint32_t i = 0; i < n; i++){
+                int weight = graph.getWeight(next, i);
+                if(done[i] || weight == -1)
+                    continue;
+                double c = weight + (pi[min(next, i)] + pi[max(next, i)]);
+                if(c < key[i]) {
+                    key[i] = c;
+                    from[i] = next;
+                }
+            }
+        }
+        return tree;
+    }
+    vector<idEdge> edges = graph.getEdges();
+    sort(edges.begin(), edges.end(), [&](const idEdge& one, const idEdge& two) {
+        double a = one.weight + pi[one.from] + pi[one.to], b = two.weight + pi[two.from] + pi[two.to];
+        return a != b ? a < b : idEdgeOrder()(one, two);
+    });
+    DisjointSet sets(n);
+    for(const idEdge& e : edges)
+        if(e.from != e.to && sets.union_(e.from, e.to))
+            tree.push_back(e);
+    return tree;
+}
+
+/**
+ * Penalized cost of an edge, summed the same way whichever end comes first so the cost of a
+ * tree edge matches itself exactly
+ * @tparam T is the type of the graph
+ * @param graph is the graph the edge is in
+ * @param a is one end of the edge
+ * @param b is the other end of the edge
+ * @return the weight plus the penalties on both ends, or infinity if there is no edge
+ */
+template <typename T>
+double OneTree::cost(const Graph<T>& graph, uint32_t a, uint32_t b) const {
+    int weight = graph.getWeight(a, b);
+    if(weight == -1)
+        return numeric_limits<double>::infinity();
+    if(a > b)
+        swap(a, b);
+    return weight + (penalty[a] + penalty[b]);
+}
+
+/**
+ * Finds the heaviest edge on the tree path from one node to every other node, in one pass
+ * over the nodes in order. The path up to the root is filled first, then every other node
+ * takes the heavier of its parent's value and the edge to its parent
+ * @param from is the node the paths start at, not the special node
+ * @param longest is set to the heaviest edge on each path, n slots
+ * @param mark is scratch space, n slots that are only ever set to a start node
+ */
+inline void OneTree::beta(uint32_t from, vector<double>& longest, vector<uint32_t>& mark) const {
+    const double none = numeric_limits<double>::lowest();
+    longest[from] = none;
+    mark[from] = from;
+    for(uint32_t node = from; parent[node] != NO_ID; node = parent[node]){
+        longest[parent[node]] = max(longest[node], up[node]);
+        mark[parent[node]] = from;
+    }
+    for(uint32_t node : order){
+        if(mark[node] == from)
+            continue;
+        longest[node] = parent[node] == NO_ID ? none : max(longest[parent[node]], up[node]);
+    }
+}
+
+/**
+ * Finds the heaviest edge on the tree path between two nodes by climbing from both ends until
+ * they meet, which is cheaper than a full pass when only a few edges per node are needed
+ * @param a is one end of the path, not the special node
+ * @param b is the other end of the path, not the special node
+ * @return the heaviest edge on the path, or the lowest double if they aren't connected
+ */
+inline double OneTree::pathMax(uint32_t a, uint32_t b) const {
+    double longest = numeric_limits<double>::lowest();
+    while(a != b){
+        if(depth[a] < depth[b])
+            swap(a, b);
+        if(parent[a] == NO_ID)
+            return numeric_limits<double>::lowest();
+        longest = max(longest, up[a]);
+        a = parent[a];
+    }
+    return longest;
+}
+
+/**
+ * Alpha value of an edge: an edge to the special node replaces its heavier edge, any other
+ * edge replaces the heaviest edge on the tree path between its ends
+ * @param a is one end of the edge
+ * @param b is the other end of the edge
+ * @param edgeCost is the penalized cost of the edge
+ * @param longest is the heaviest edge on the tree path between the ends, unused if either is
+ * the special node
+ * @return how much longer the 1-tree gets by having to use the edge, 0 for a 1-tree edge
+ */
+inline double OneTree::alpha(uint32_t a, uint32_t b, double edgeCost, double longest) const {
+    if(a == special || b == special) {
+        uint32_t other = a == special ? b : a;
+        if(other == first || other == second)
+            return 0;
+        return max(0.0, edgeCost - secondCost);
+    }
+    return max(0.0, edgeCost - longest);
+}
+
+#endif //TSP_ONETREE_H
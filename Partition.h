@@ -0,0 +1,373 @@
+/**
+ * Local search on a partitioned tour across a thread pool
+ * The tour is cut into consecutive parts and every part is improved on its own with 2-opt and
+ * Or-opt moves that keep the two cities at its ends in place, so the parts can be searched at
+ * the same time and joined back as they are. Every other round the cuts move by half a part so
+ * moves across the old cuts are found too, and a last serial pass picks up the moves between
+ * cities that never share a part. The parts only depend on the seed, the thread count and the
+ * tour, so the result is the same on every run
+ */
+
+#ifndef TSP_PARTITION_H
+#define TSP_PARTITION_H
+
+#include <vector>
+#include <deque>
+#include <random>
+#include <algorithm>
+#include "LocalSearch.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+template <typename T, typename TourType = ArrayTour>
+class PartitionSearch : public LocalSearch<T, TourType>{
+public:
+    explicit PartitionSearch(Graph<T>& gr) : LocalSearch<T, TourType>(gr) {}
+    vector<T> optimize(const vector<T>& path);
+    void setRounds(uint32_t count) {maxRounds = count;}
+    void setSeed(uint32_t value) {seed = value;}
+    uint32_t getRounds() const {return rounds;}
+    uint32_t getParts() const {return parts;}
+protected:
+    static const uint32_t MIN_PART = 16;    // shorter parts leave too few moves inside them
+    static const uint32_t MAX_PART = 5000;  // longer parts make the reversals slow
+    uint32_t maxRounds = 16;
+    uint32_t seed = 1;
+    uint32_t rounds = 0;
+    uint32_t parts = 0;
+    vector<uint32_t> owner;     // part of every city in the current round
+    vector<uint32_t> where;     // position of every city in its part
+    vector<char> blocked;       // cities that skipped a move because it left their part
+    bool searchPart(uint32_t* part, uint32_t size, uint32_t index);
+    bool pathTwoOpt(uint32_t* part, uint32_t size, uint32_t index, uint32_t a, deque<uint32_t>& queue, bool& skipped);
+    bool pathOrOpt(uint32_t* part, uint32_t size, uint32_t index, uint32_t a, deque<uint32_t>& queue, bool& skipped);
+    bool pathSegment(uint32_t* part, uint32_t size, uint32_t index, uint32_t first, uint32_t last,
+                     deque<uint32_t>& queue, bool& skipped);
+    void reversePath(uint32_t* part, uint32_t from, uint32_t to);
+    void movePath(uint32_t* part, uint32_t first, uint32_t last, uint32_t after, bool reversed);
+    void wakeIn(deque<uint32_t>& queue, uint32_t city);
+};
+
+/**
+ * Improves a tour with 2-opt and Or-opt, searching the parts of the tour in parallel until a
+ * round moves nothing twice in a row or the round limit is reached
+ * @tparam T is the type of the graph
+ * @tparam TourType is ArrayTour, or TwoLevelTour for large tours
+ * @param path is a closed tour to start from, like the one returned by getPath
+ * @return the improved tour, or the same one if it doesn't visit every node exactly once
+ */
+template <typename T, typename TourType>
+vector<T> PartitionSearch<T, TourType>::optimize(const vector<T>& path) {
+    vector<uint32_t> order;
+    rounds = 0;
+    parts = 0;
+    if(!this->toIds(path, order))
+        return path;
+    uint32_t n = static_cast<uint32_t>(order.size());
+    ThreadPool pool(this->threads);
+    parts = max<uint32_t>(pool.getSize(), (n + MAX_PART - 1) / MAX_PART);
+    parts = min<uint32_t>(parts, n / MIN_PART);
+    this->dontLook.assign(n, 0);
+    blocked.assign(n, 0);
+    owner.assign(n, 0);
+    where.assign(n, 0);
+    mt19937 rng(seed);
+    uint32_t start = n == 0 ? 0 : rng() % n;
+    uint32_t idle = 0;
+    while(parts >= 2 && rounds < maxRounds && idle < 2){
+        // every other round the cuts sit halfway between the last round's cuts
+        uint32_t offset = (start + (rounds % 2) * (n / parts / 2)) % n;
+        rotate(order.begin(), order.begin() + offset, order.end());
+        for(uint32_t p = 0; p < parts; p++){
+            size_t begin = static_cast<size_t>(p) * n / parts, end = static_cast<size_t>(p + 1) * n / parts;
+            for(size_t i = begin; i < end; i++){
+                owner[order[i]] = p;
+                where[order[i]] = static_cast<uint32_t>(i - begin);
+            }
+        }
+        for(uint32_t i = 0; i < n; i++){
+            if(blocked[order[i]]) {
+                blocked[order[i]] = 0;
+                this->dontLook[order[i]] = 0;
+            }
+        }
+        vector<char> moved(parts, 0);
+        pool.parallelFor(0, parts, [&](size_t lo, size_t hi, unsigned) {
+            for(size_t p = lo; p < hi; p++){
+                size_t begin = p * n / parts, end = (p + 1) * n / parts;
+                moved[p] = searchPart(order.data() + begin, static_cast<uint32_t>(end - begin), static_cast<uint32_t>(p));
+            }
+        });
+        rounds++;
+        idle = find(moved.begin(), moved.end(), 1) == moved.end() ? idle + 1 : 0;
+    }
+    // the cities left are the ones with candidates the parts kept apart
+    TourType tour(order);
+    this->active.clear();
+    for(uint32_t i = 0; i < n; i++){
+        if(blocked[order[i]] || parts < 2)
+            this->dontLook[order[i]] = 0;
+        if(!this->dontLook[order[i]])
+            this->active.push_back(order[i]);
+    }
+    while(!this->active.empty()){
+        uint32_t a = this->active.front();
+        this->active.pop_front();
+        this->dontLook[a] = 1;
+        if(this->twoOptMove(tour, a) || this->orOptMove(tour, a))
+            this->wake(a);
+    }
+    return this->toPath(tour.getOrder());
+}
+
+/**
+ * Runs 2-opt and Or-opt on one part until none of its awake cities has a move inside it
+ * @tparam T is the type of the graph
+ * @param part is the cities of the part in tour order, the first and last ones stay in place
+ * @param size is the number of cities in the part
+ * @param index is the number of the part
+ * @return true if the part was changed
+ */
+template <typename T, typename TourType>
+bool PartitionSearch<T, TourType>::searchPart(uint32_t* part, uint32_t size, uint32_t index) {
+    deque<uint32_t> queue;
+    for(uint32_t i = 0; i < size; i++){
+        if(!this->dontLook[part[i]])
+            queue.push_back(part[i]);
+    }
+    bool moved = false;
+    while(!queue.empty()){
+        uint32_t a = queue.front();
+        queue.pop_front();
+        this->dontLook[a] = 1;
+        bool skipped = false;
+        if(pathTwoOpt(part, size, index, a, queue, skipped) || pathOrOpt(part, size, index, a, queue, skipped)) {
+            wakeIn(queue, a);
+            moved = true;
+        }
+        else if(skipped)
+            blocked[a] = 1;
+    }
+    return moved;
+}
+
+/**
+ * Looks for an improving 2-opt move inside a part, like twoOptMove, and applies the first one
+ * found by reversing the cities between the two removed edges
+ * @tparam T is the type of the graph
+ * @param part is the cities of the part in tour order
+ * @param size is the number of cities in the part
+ * @param index is the number of the part
+ * @param a is the city to look at
+ * @param queue is the part's queue of awake cities
+ * @param skipped is set to true if a move was passed over because it left the part
+ * @return true if the part was changed
+ */
+template <typename T, typename TourType>
+bool PartitionSearch<T, TourType>::pathTwoOpt(uint32_t* part, uint32_t size, uint32_t index, uint32_t a,
+                                              deque<uint32_t>& queue, bool& skipped) {
+    uint32_t at = where[a];
+    const uint32_t* near = this->cand.get(a);
+    for(int dir = 0; dir < 2; dir++){
+        if(dir == 0 ? at + 1 >= size : at == 0) {    // the edge leads out of the part
+            skipped = true;
+            continue;
+        }
+        uint32_t b = part[dir == 0 ? at + 1 : at - 1];
+        long long ab = this->dist(a, b);
+        for(uint32_t i = 0; i < this->cand.count(a); i++){
+            uint32_t c = near[i];
+            long long ac = this->dist(a, c);
+            if(ac >= ab)
+                break;
+            if(owner[c] != index) {
+                skipped = true;
+                continue;
+            }
+            uint32_t j = where[c];
+            if(dir == 0 ? j + 1 >= size : j == 0) {
+                skipped = true;
+                continue;
+            }
+            uint32_t d = part[dir == 0 ? j + 1 : j - 1];
+            if(c == b || d == a)
+                continue;
+            if(ac + this->dist(b, d) < ab + this->dist(c, d)) {
+                // the removed edges start at x and y, and everything between them turns around
+                uint32_t x = min(at, j), y = max(at, j);
+                if(dir == 1) {
+                    x--;
+                    y--;
+                }
+                reversePath(part, x + 1, y);
+                wakeIn(queue, b);
+                wakeIn(queue, c);
+                wakeIn(queue, d);
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Looks for an improving Or-opt move inside a part, like orOptMove, for the segments of 1 to
+ * 3 cities starting or ending at a city
+ * @tparam T is the type of the graph
+ * @param part is the cities of the part in tour order
+ * @param size is the number of cities in the part
+ * @param index is the number of the part
+ * @param a is the city to look at
+ * @param queue is the part's queue of awake cities
+ * @param skipped is set to true if a move was passed over because it left the part
+ * @return true if the part was changed
+ */
+template <typename T, typename TourType>
+bool PartitionSearch<T, TourType>::pathOrOpt(uint32_t* part, uint32_t size, uint32_t index, uint32_t a,
+                                             deque<uint32_t>& queue, bool& skipped) {
+    if(size < 8)
+        return false;
+    uint32_t i = where[a];
+    for(uint32_t len = 1; len <= 3; len++){
+        // the segment can't hold the ends of the part, they stay in place
+        if(i >= 1 && i + len <= size - 1) {
+            if(pathSegment(part, size, index, i, i + len - 1, queue, skipped))
+                return true;
+        }
+        else
+            skipped = true;
+        if(len > 1) {
+            if(i + 1 >= len + 1 && i + 2 <= size) {
+                if(pathSegment(part, size, index, i + 1 - len, i, queue, skipped))
+                    return true;
+            }
+            else
+                skipped = true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Tries to move one segment of a part next to a candidate of either of its ends, like
+ * orOptSegment
+ * @tparam T is the type of the graph
+ * @param part is the cities of the part in tour order
+ * @param size is the number of cities in the part
+ * @param index is the number of the part
+ * @param first is the position of the first city of the segment, at least 1
+ * @param last is the position of the last city of the segment, at most size - 2
+ * @param queue is the part's queue of awake cities
+ * @param skipped is set to true if a move was passed over because it left the part
+ * @return true if the segment was moved
+ */
+template <typename T, typename TourType>
+bool PartitionSearch<T, TourType>::pathSegment(uint32_t* part, uint32_t size, uint32_t index, uint32_t first,
+                                               uint32_t last, deque<uint32_t>& queue, bool& skipped) {
+    uint32_t s1 = part[first], s2 = part[last];
+    uint32_t p = part[first - 1], nx = part[last + 1];
+    long long removed = this->dist(p, s1) + this->dist(s2, nx) - this->dist(p, nx);
+    if(removed <= 0)
+        return false;
+    for(int end = 0; end < 2; end++){
+        uint32_t s = end == 0 ? s1 : s2;
+        uint32_t other = end == 0 ? s2 : s1;
+        const uint32_t* near = this->cand.get(s);
+        for(uint32_t i = 0; i < this->cand.count(s); i++){
+            uint32_t c = near[i];
+            if(this->dist(s, c) >= removed)
+                break;
+            if(owner[c] != index) {
+                skipped = true;
+                continue;
+            }
+            uint32_t j = where[c];
+            if(j >= first && j <= last)
+                continue;
+            for(int side = 0; side < 2; side++){
+                if(side == 0 ? j + 1 >= size : j == 0) {
+                    skipped = true;
+                    continue;
+                }
+                // the segment goes between the cities at k and k + 1
+                uint32_t k = side == 0 ? j : j - 1;
+                if(k + 1 >= first && k <= last)
+                    continue;
+                uint32_t u = part[k], v = part[k + 1];
+                uint32_t nearU = side == 0 ? s : other;
+                uint32_t nearV = side == 0 ? other : s;
+                long long added = this->dist(u, nearU) + this->dist(nearV, v) - this->dist(u, v);
+                if(added < removed) {
+                    movePath(part, first, last, k, nearU != s1);
+                    uint32_t ends[] = {p, nx, s1, s2, u, v};
+                    for(int e = 0; e < 6; e++)
+                        wakeIn(queue, ends[e]);
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Reverses the cities of a part between two positions
+ * @tparam T is the type of the graph
+ * @param part is the cities of the part in tour order
+ * @param from is the first position to reverse
+ * @param to is the last position to reverse
+ */
+template <typename T, typename TourType>
+void PartitionSearch<T, TourType>::reversePath(uint32_t* part, uint32_t from, uint32_t to) {
+    reverse(part + from, part + to + 1);
+    for(uint32_t i = from; i <= to; i++)
+        where[part[i]] = i;
+}
+
+/**
+ * Moves a segment of a part so it follows the city at a position outside of it
+ * @tparam T is the type of the graph
+ * @param part is the cities of the part in tour order
+ * @param first is the position of the first city of the segment
+ * @param last is the position of the last city of the segment
+ * @param after is the position of the city the segment goes after
+ * @param reversed is true if the segment should go in last city first
+ */
+template <typename T, typename TourType>
+void PartitionSearch<T, TourType>::movePath(uint32_t* part, uint32_t first, uint32_t last, uint32_t after, bool reversed) {
+    uint32_t len = last - first + 1;
+    uint32_t from, lo, hi;   // where the segment ends up, and the positions that changed
+    if(after > last) {
+        rotate(part + first, part + last + 1, part + after + 1);
+        from = after + 1 - len;
+        lo = first;
+        hi = after;
+    }
+    else {
+        rotate(part + after + 1, part + first, part + last + 1);
+        from = after + 1;
+        lo = after + 1;
+        hi = last;
+    }
+    if(reversed)
+        reverse(part + from, part + from + len);
+    for(uint32_t i = lo; i <= hi; i++)
+        where[part[i]] = i;
+}
+
+/**
+ * Turns a city's don't-look bit off, queueing it in its part if it was on
+ * @tparam T is the type of the graph
+ * @param queue is the part's queue of awake cities
+ * @param city is the id of the city, it must be in the part
+ */
+template <typename T, typename TourType>
+void PartitionSearch<T, TourType>::wakeIn(deque<uint32_t>& queue, uint32_t city) {
+    if(this->dontLook[city]) {
+        this->dontLook[city] = 0;
+        queue.push_back(city);
+    }
+}
+
+#endif //TSP_PARTITION_H
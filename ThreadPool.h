@@ -0,0 +1,143 @@
+/**
+ * Fixed size pool of worker threads
+ * Tasks are run in the order they are queued, and parallelFor splits a range into one chunk
+ * per worker so the split only depends on the size of the pool
+ */
+
+#ifndef TSP_THREADPOOL_H
+#define TSP_THREADPOOL_H
+
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+using namespace std;
+
+class ThreadPool{
+public:
+    explicit ThreadPool(unsigned count = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    unsigned getSize() const {return static_cast<unsigned>(workers.size());}
+    void submit(function<void()> task);
+    void wait();
+    template <typename F>
+    void parallelFor(size_t begin, size_t end, F func);
+    static unsigned defaultSize();
+private:
+    vector<thread> workers;
+    queue<function<void()>> tasks;
+    mutex lock;
+    condition_variable hasTask;
+    condition_variable isIdle;
+    size_t running;
+    bool stopping;
+    void work();
+};
+
+/**
+ * Number of threads to use when none is given
+ * @return the number of hardware threads, at least 1
+ */
+inline unsigned ThreadPool::defaultSize() {
+    unsigned count = thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+/**
+ * Starts the workers
+ * @param count is the number of threads, 0 for one per hardware thread
+ */
+inline ThreadPool::ThreadPool(unsigned count) : running(0), stopping(false) {
+    if(count == 0)
+        count = defaultSize();
+    for(unsigned i = 0; i < count; i++)
+        workers.emplace_back(&ThreadPool::work, this);
+}
+
+/**
+ * Finishes the queued tasks and joins the workers
+ */
+inline ThreadPool::~ThreadPool() {
+    {
+        unique_lock<mutex> guard(lock);
+        stopping = true;
+    }
+    hasTask.notify_all();
+    for(unsigned i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+/**
+ * Queues a task
+ * @param task is the function to run on a worker
+ */
+inline void ThreadPool::submit(function<void()> task) {
+    {
+        unique_lock<mutex> guard(lock);
+        tasks.push(move(task));
+    }
+    hasTask.notify_one();
+}
+
+/**
+ * Blocks until every queued task has finished
+ */
+inline void ThreadPool::wait() {
+    unique_lock<mutex> guard(lock);
+    isIdle.wait(guard, [this]{return tasks.empty() && running == 0;});
+}
+
+/**
+ * Runs tasks until the pool is destroyed
+ */
+inline void ThreadPool::work() {
+    while(true){
+        function<void()> task;
+        {
+            unique_lock<mutex> guard(lock);
+            hasTask.wait(guard, [this]{return stopping || !tasks.empty();});
+            if(tasks.empty())
+                return;
+            task = move(tasks.front());
+            tasks.pop();
+            running++;
+        }
+        task();
+        {
+            unique_lock<mutex> guard(lock);
+            running--;
+            if(tasks.empty() && running == 0)
+                isIdle.notify_all();
+        }
+    }
+}
+
+/**
+ * Splits [begin, end) into one contiguous chunk per worker and waits for all of them
+ * @tparam F is called as func(chunkBegin, chunkEnd, chunk)
+ * @param begin is the first index
+ * @param end is one past the last index
+ * @param func is the work for one chunk
+ */
+template <typename F>
+void ThreadPool::parallelFor(size_t begin, size_t end, F func) {
+    if(end <= begin)
+        return;
+    size_t chunks = getSize();
+    size_t size = (end - begin + chunks - 1) / chunks;
+    for(size_t c = 0; c < chunks; c++){
+        size_t lo = begin + c * size;
+        size_t hi = lo + size < end ? lo + size : end;
+        if(lo >= hi)
+            break;
+        submit([=]{func(lo, hi, static_cast<unsigned>(c));});
+    }
+    wait();
+}
+
+#endif //TSP_THREADPOOL_H
@@ -0,0 +1,392 @@
+/**
+ * Tour representations for local search
+ * ArrayTour keeps the cities in an array with the position of every city alongside it, so
+ * next, prev and between are O(1) and reversing a segment costs the shorter of the segment
+ * and the rest of the tour
+ * TwoLevelTour splits the tour into about sqrt(n) segments, each with a reversed bit, so a
+ * reversal only splits the two end segments and turns around the segments in between, which
+ * is O(sqrt(n)). Both have the same interface, so the local search can run on either
+ */
+
+#ifndef TSP_TOUR_H
+#define TSP_TOUR_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include "various.h"
+
+using namespace std;
+
+class ArrayTour{
+public:
+    ArrayTour() = default;
+    explicit ArrayTour(const vector<uint32_t>& order) {load(order);}
+    void load(const vector<uint32_t>& order);
+    vector<uint32_t> getOrder() const {return cities;}
+    uint32_t size() const {return static_cast<uint32_t>(cities.size());}
+    uint32_t next(uint32_t city) const;
+    uint32_t prev(uint32_t city) const;
+    bool between(uint32_t a, uint32_t b, uint32_t c) const;
+    void flip(uint32_t from, uint32_t to);
+    void swapCities(uint32_t a, uint32_t b);
+private:
+    vector<uint32_t> cities;    // the tour in order
+    vector<uint32_t> pos;       // where every city is in cities
+};
+
+/**
+ * Replaces the tour
+ * @param order is every city exactly once, in tour order
+ */
+inline void ArrayTour::load(const vector<uint32_t>& order) {
+    cities = order;
+    pos.assign(order.size(), NO_ID);
+    for(uint32_t i = 0; i < cities.size(); i++)
+        pos[cities[i]] = i;
+}
+
+/**
+ * @param city is a city in the tour
+ * @return the city after it
+ */
+inline uint32_t ArrayTour::next(uint32_t city) const {
+    uint32_t i = pos[city] + 1;
+    return cities[i == cities.size() ? 0 : i];
+}
+
+/**
+ * @param city is a city in the tour
+ * @return the city before it
+ */
+inline uint32_t ArrayTour::prev(uint32_t city) const {
+    uint32_t i = pos[city];
+    return cities[i == 0 ? cities.size() - 1 : i - 1];
+}
+
+/**
+ * Checks if b is reached on the way forward from a to c, ends included
+ * @param a is where the path starts
+ * @param b is the city to look for
+ * @param c is where the path ends
+ * @return true if b is on the path
+ */
+inline bool ArrayTour::between(uint32_t a, uint32_t b, uint32_t c) const {
+    uint32_t pa = pos[a], pb = pos[b], pc = pos[c];
+    if(pa <= pc)
+        return pa <= pb && pb <= pc;
+    return pb >= pa || pb <= pc;
+}
+
+/**
+ * Reverses the path going forward from one city to another. The tour is a cycle, so when the
+ * path is more than half of it the rest is reversed instead, which gives the same tour
+ * travelled the other way
+ * @param from is the first city of the path
+ * @param to is the last city of the path
+ */
+inline void ArrayTour::flip(uint32_t from, uint32_t to) {
+    uint32_t n = size();
+    uint32_t i = pos[from], j = pos[to];
+    uint32_t len = (j + n - i) % n + 1;
+    if(2 * len > n) {   // reverse the complement
+        uint32_t after = j + 1 == n ? 0 : j + 1;
+        j = i == 0 ? n - 1 : i - 1;
+        i = after;
+        len = n - len;
+    }
+    for(uint32_t k = 0; k < len / 2; k++){
+        swap(cities[i], cities[j]);
+        pos[cities[i]] = i;
+        pos[cities[j]] = j;
+        i = i + 1 == n ? 0 : i + 1;
+        j = j == 0 ? n - 1 : j - 1;
+    }
+}
+
+/**
+ * Exchanges the places of two cities in the tour
+ * @param a is one of the cities
+ * @param b is the other city
+ */
+inline void ArrayTour::swapCities(uint32_t a, uint32_t b) {
+    swap(cities[pos[a]], cities[pos[b]]);
+    swap(pos[a], pos[b]);
+}
+
+class TwoLevelTour{
+public:
+    TwoLevelTour() = default;
+    explicit TwoLevelTour(const vector<uint32_t>& order) {load(order);}
+    void load(const vector<uint32_t>& order);
+    vector<uint32_t> getOrder() const;
+    uint32_t size() const {return static_cast<uint32_t>(parent.size());}
+    uint32_t next(uint32_t city) const;
+    uint32_t prev(uint32_t city) const;
+    bool between(uint32_t a, uint32_t b, uint32_t c) const;
+    void flip(uint32_t from, uint32_t to);
+private:
+    // a run of cities that were consecutive when the tour was loaded
+    struct segment{
+        uint32_t first, last;   // ends of the run in load order
+        uint32_t size;
+        uint32_t next, prev;    // neighboring segments in tour order
+        uint32_t rank;          // position in tour order, counted from head
+        bool reversed;          // true if the run is travelled from last to first
+    };
+    vector<segment> segs;
+    uint32_t head = 0;          // the segment ranks are counted from
+    uint32_t limit = 0;         // segment count that triggers a rebuild
+    vector<uint32_t> parent;    // segment of every city
+    vector<uint32_t> seq;       // position of every city in load order
+    vector<uint32_t> after;     // next city in load order
+    vector<uint32_t> before;    // previous city in load order
+    uint32_t headOf(uint32_t s) const {return segs[s].reversed ? segs[s].last : segs[s].first;}
+    uint32_t tailOf(uint32_t s) const {return segs[s].reversed ? segs[s].first : segs[s].last;}
+    long long key(uint32_t city) const;
+    uint32_t pathLength(uint32_t from, uint32_t to) const;
+    void splitBefore(uint32_t city);
+    void renumber();
+};
+
+/**
+ * Replaces the tour and cuts it into segments of about sqrt(n) cities
+ * @param order is every city exactly once, in tour order
+ */
+inline void TwoLevelTour::load(const vector<uint32_t>& order) {
+    uint32_t n = static_cast<uint32_t>(order.size());
+    parent.assign(n, 0);
+    seq.assign(n, 0);
+    after.assign(n, 0);
+    before.assign(n, 0);
+    segs.clear();
+    if(n == 0)
+        return;
+    uint32_t group = 1;
+    while(group * group < n)
+        group++;
+    for(uint32_t i = 0; i < n; i++){
+        uint32_t city = order[i];
+        seq[city] = i;
+        after[city] = order[i + 1 == n ? 0 : i + 1];
+        before[city] = order[i == 0 ? n - 1 : i - 1];
+        if(i % group == 0) {
+            segment sg = {city, city, 0, 0, 0, 0, false};
+            segs.push_back(sg);
+        }
+        segment& cur = segs.back();
+        cur.last = city;
+        cur.size++;
+        parent[city] = static_cast<uint32_t>(segs.size() - 1);
+    }
+    uint32_t count = static_cast<uint32_t>(segs.size());
+    for(uint32_t i = 0; i < count; i++){
+        segs[i].next = i + 1 == count ? 0 : i + 1;
+        segs[i].prev = i == 0 ? count - 1 : i - 1;
+        segs[i].rank = i;
+    }
+    head = 0;
+    limit = 3 * count + 8;
+}
+
+/**
+ * @return every city in tour order
+ */
+inline vector<uint32_t> TwoLevelTour::getOrder() const {
+    vector<uint32_t> order;
+    if(parent.empty())
+        return order;
+    order.reserve(parent.size());
+    uint32_t city = headOf(head);
+    for(uint32_t i = 0; i < parent.size(); i++){
+        order.push_back(city);
+        city = next(city);
+    }
+    return order;
+}
+
+/**
+ * @param city is a city in the tour
+ * @return the city after it
+ */
+inline uint32_t TwoLevelTour::next(uint32_t city) const {
+    const segment& sg = segs[parent[city]];
+    if(city == tailOf(parent[city]))
+        return headOf(sg.next);
+    return sg.reversed ? before[city] : after[city];
+}
+
+/**
+ * @param city is a city in the tour
+ * @return the city before it
+ */
+inline uint32_t TwoLevelTour::prev(uint32_t city) const {
+    const segment& sg = segs[parent[city]];
+    if(city == headOf(parent[city]))
+        return tailOf(sg.prev);
+    return sg.reversed ? after[city] : before[city];
+}
+
+/**
+ * Orders cities by where they are in the tour, counted from the head segment
+ * @param city is a city in the tour
+ * @return a key that grows going forward from the head segment
+ */
+inline long long TwoLevelTour::key(uint32_t city) const {
+    const segment& sg = segs[parent[city]];
+    long long inside = sg.reversed ? static_cast<long long>(seq[sg.last]) - seq[city] : static_cast<long long>(seq[city]) - seq[sg.first];
+    return (static_cast<long long>(sg.rank) << 32) + inside;
+}
+
+/**
+ * Checks if b is reached on the way forward from a to c, ends included
+ * @param a is where the path starts
+ * @param b is the city to look for
+ * @param c is where the path ends
+ * @return true if b is on the path
+ */
+inline bool TwoLevelTour::between(uint32_t a, uint32_t b, uint32_t c) const {
+    long long ka = key(a), kb = key(b), kc = key(c);
+    if(ka <= kc)
+        return ka <= kb && kb <= kc;
+    return kb >= ka || kb <= kc;
+}
+
+/**
+ * Counts the cities on the way forward from one city to another, ends included, by adding up
+ * the sizes of the segments in between
+ * @param from is where the path starts
+ * @param to is where the path ends
+ * @return the number of cities on the path
+ */
+inline uint32_t TwoLevelTour::pathLength(uint32_t from, uint32_t to) const {
+    uint32_t s = parent[from], e = parent[to];
+    long long inFrom = key(from) & UINT32_MAX, inTo = key(to) & UINT32_MAX;
+    if(s == e && inFrom <= inTo)
+        return static_cast<uint32_t>(inTo - inFrom + 1);
+    long long count = segs[s].size - inFrom + inTo + 1;
+    for(uint32_t cur = segs[s].next; cur != e; cur = segs[cur].next)
+        count += segs[cur].size;
+    return static_cast<uint32_t>(count);
+}
+
+/**
+ * Splits a city's segment so the city starts a segment in tour order. The smaller side moves
+ * to a new segment, so it costs at most half a segment. The ranks are left for the caller
+ * to renumber
+ * @param city is the city that should start a segment
+ */
+inline void TwoLevelTour::splitBefore(uint32_t city) {
+    uint32_t s = parent[city];
+    if(city == headOf(s))
+        return;
+    segment& sg = segs[s];
+    // in load order the run is cut between lo and hi
+    uint32_t hi = sg.reversed ? after[city] : city;
+    uint32_t lo = before[hi];
+    uint32_t upper = seq[sg.last] - seq[hi] + 1;
+    uint32_t lower = sg.size - upper;
+    segment piece = {0, 0, 0, 0, 0, 0, sg.reversed};
+    uint32_t id = static_cast<uint32_t>(segs.size());
+    bool pieceAfter;    // true if the new segment follows the old one in tour order
+    uint32_t move;      // first city to move, in load order
+    if(upper <= lower) {    // hi..last moves
+        piece.first = hi;
+        piece.last = sg.last;
+        piece.size = upper;
+        sg.last = lo;
+        sg.size = lower;
+        pieceAfter = !sg.reversed;
+        move = hi;
+    }
+    else {  // first..lo moves
+        piece.first = sg.first;
+        piece.last = lo;
+        piece.size = lower;
+        sg.first = hi;
+        sg.size = upper;
+        pieceAfter = sg.reversed;
+        move = piece.first;
+    }
+    for(uint32_t i = 0, cur = move; i < piece.size; i++, cur = after[cur])
+        parent[cur] = id;
+    if(pieceAfter) {
+        piece.prev = s;
+        piece.next = sg.next;
+    }
+    else {
+        piece.next = s;
+        piece.prev = sg.prev;
+    }
+    segs.push_back(piece);  // sg can't be used after this
+    segs[segs[id].prev].next = id;
+    segs[segs[id].next].prev = id;
+}
+
+/**
+ * Reverses the path going forward from one city to another. When the path is more than half
+ * of the tour the rest is reversed instead, which gives the same tour travelled the other way.
+ * The segments at both ends are split so the path is made of whole segments, then those
+ * segments are put in the opposite order with their reversed bits flipped
+ * @param from is the first city of the path
+ * @param to is the last city of the path
+ */
+inline void TwoLevelTour::flip(uint32_t from, uint32_t to) {
+    uint32_t n = size();
+    if(from == to)
+        return;
+    uint32_t len = pathLength(from, to);
+    if(len == n)
+        return;
+    if(2 * len > n) {
+        uint32_t newFrom = next(to);
+        to = prev(from);
+        from = newFrom;
+        if(from == to)
+            return;
+    }
+    if(segs.size() >= limit)    // too many small segments, so cut the tour up again
+        load(getOrder());
+    uint32_t end = next(to);
+    splitBefore(from);
+    splitBefore(end);
+    uint32_t first = parent[from], last = parent[to];
+    uint32_t outBefore = segs[first].prev, outAfter = segs[last].next;
+    vector<uint32_t> run;
+    for(uint32_t cur = first; ; cur = segs[cur].next){
+        run.push_back(cur);
+        if(cur == last)
+            break;
+    }
+    // outBefore, run reversed, outAfter
+    uint32_t link = outBefore;
+    for(size_t i = run.size(); i-- > 0;){
+        uint32_t cur = run[i];
+        segs[cur].reversed = !segs[cur].reversed;
+        segs[cur].prev = link;
+        segs[link].next = cur;
+        link = cur;
+    }
+    segs[link].next = outAfter;
+    segs[outAfter].prev = link;
+    for(size_t i = 0; i < run.size(); i++)
+        if(run[i] == head) {   // keep the head outside of the moved run
+            head = outAfter;
+            break;
+        }
+    renumber();
+}
+
+/**
+ * Numbers the segments in tour order starting from the head segment
+ */
+inline void TwoLevelTour::renumber() {
+    uint32_t cur = head;
+    uint32_t rank = 0;
+    do{
+        segs[cur].rank = rank++;
+        cur = segs[cur].next;
+    } while(cur != head);
+}
+
+#endif //TSP_TOUR_H
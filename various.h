@@ -6,7 +6,12 @@
 #define INC_20S_PA02_RANIROGAN_VARIOUS_H
 
 #include <stack>
+#include <cstdint>
 using namespace std;
+
+// id returned when a label has not been added to a graph
+static const uint32_t NO_ID = UINT32_MAX;
+
 template <typename T>
 struct edge{
     T to;
@@ -31,9 +36,43 @@ struct weightEdge{
     int weight;
 };
 
+// weighted edge between two interned node ids
+struct idEdge{
+    uint32_t from;
+    uint32_t to;
+    int weight;
+};
+
+// summary of the tour costs from several runs of a solver
+struct costSpread{
+    uint32_t runs;
+    long long best;
+    long long worst;
+    double mean;
+    double stdDev;
+};
+
 enum set_Type{my, ll, DEFAULT};
 
-enum algo_Type{trivial, optimal, UNSET};
+enum algo_Type{trivial, optimal, multistart, lk, anneal, genetic, colony, exact, UNSET};
+
+// how the annealing temperature falls over the budget
+enum cool_Type{c_geometric, c_linear};
+
+// local search run on the finished tour
+enum improve_Type{i_none, i_twoOpt, i_orOpt, i_both, i_parallel};
+
+// how a graph indexes its edge weights, s_auto switches to dense once the graph is complete
+enum storage_Type{s_sparse, s_dense, s_auto};
+
+// spanning tree algorithm, mst_auto picks one from the density of the graph
+enum mst_Type{mst_kruskal, mst_prim, mst_primHeap, mst_boruvka, mst_filterKruskal, mst_auto};
+
+// all pairs shortest path algorithm for the metric closure, apsp_auto picks one from the density
+enum apsp_Type{apsp_dijkstra, apsp_floyd, apsp_auto};
+
+// element type of a dense distance matrix
+enum matrix_Type{m_int32, m_int16, m_float};
 
 template <typename T>
 struct customFunc{
@@ -41,4 +80,17 @@ struct customFunc{
         return one.weight < two.weight;
     }
 };
+// orders edges by weight, breaking ties by the ordered pair of ids so every spanning tree
+// algorithm picks the same tree
+struct idEdgeOrder{
+    inline bool operator() (const idEdge& one, const idEdge& two) const {
+        if(one.weight != two.weight)
+            return one.weight < two.weight;
+        uint32_t oneLo = one.from < one.to ? one.from : one.to;
+        uint32_t twoLo = two.from < two.to ? two.from : two.to;
+        if(oneLo != twoLo)
+            return oneLo < twoLo;
+        return (one.from ^ one.to ^ oneLo) < (two.from ^ two.to ^ twoLo);
+    }
+};
 #endif //INC_20S_PA02_RANIROGAN_VARIOUS_H